@@ -0,0 +1,352 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * Finds the combinations of `k` entries of a sorted list that add up to a target.
+ * Every distinct combination of values is reported once, in ascending order, by calling `emit` with a
+ * `std::span<const value_t>` of the `k` values as soon as it is found. An `emit` that returns `false` stops the search.
+ */
+namespace ksum {
+
+using value_t = int64_t;
+using values_t = std::vector<value_t>;
+
+template<typename Emit>
+bool report(Emit& emit, std::span<const value_t> values) {
+  if constexpr (std::is_void_v<std::invoke_result_t<Emit&, std::span<const value_t>>>) {
+    emit(values);
+    return true;
+  } else {
+    return emit(values);
+  }
+}
+
+// membership test: a bitset when the value range is small enough, a hash set otherwise
+class value_set {
+public:
+  static constexpr value_t max_bitset_range = value_t{1} << 27;
+
+  explicit value_set(std::span<const value_t> sorted) {
+    if (sorted.empty())
+      return;
+    lo = sorted.front();
+    auto range = sorted.back() - sorted.front();
+    if (range >= 0 && range < max_bitset_range) {
+      bits.resize(range + 1);
+      for (auto v : sorted)
+        bits[v - lo] = true;
+    } else {
+      hashed.insert(sorted.begin(), sorted.end());
+    }
+  }
+
+  [[nodiscard]] bool contains(value_t v) const {
+    if (!bits.empty())
+      return v >= lo && v - lo < static_cast<value_t>(bits.size()) && bits[v - lo];
+    return hashed.contains(v);
+  }
+
+private:
+  value_t lo = 0;
+  std::vector<bool> bits;
+  std::unordered_set<value_t> hashed;
+};
+
+// a single pass over the distinct values, looking up the complement
+template<typename Emit>
+void pairs(std::span<const value_t> sorted, const value_set& present, value_t target, Emit&& emit) {
+  for (size_t i = 0; i < sorted.size(); i++) {
+    auto x = sorted[i];
+    if (i > 0 && sorted[i-1] == x)
+      continue;
+    auto y = target - x;
+    if (y < x)
+      break;
+    if (y == x ? (i + 1 < sorted.size() && sorted[i+1] == x) : present.contains(y)) {
+      value_t found[] = {x, y};
+      if (!report(emit, found))
+        return;
+    }
+  }
+}
+
+template<typename Emit>
+void pairs(std::span<const value_t> sorted, value_t target, Emit&& emit) {
+  pairs(sorted, value_set{sorted}, target, std::forward<Emit>(emit));
+}
+
+// the triples whose smallest entry sits at index `i`: a two-pointer sweep over the entries after it
+template<typename Emit>
+bool triples_from(std::span<const value_t> sorted, size_t i, value_t target, Emit& emit) {
+  auto x = sorted[i];
+  if (i > 0 && sorted[i-1] == x)
+    return true;
+  size_t lo = i + 1, hi = sorted.size() - 1;
+  while (lo < hi) {
+    auto sum = x + sorted[lo] + sorted[hi];
+    if (sum < target) {
+      lo++;
+    } else if (sum > target) {
+      hi--;
+    } else {
+      value_t found[] = {x, sorted[lo], sorted[hi]};
+      if (!report(emit, found))
+        return false;
+      for (auto v = sorted[lo]; lo < hi && sorted[lo] == v; lo++) {}
+      for (auto v = sorted[hi]; lo < hi && sorted[hi] == v; hi--) {}
+    }
+  }
+  return true;
+}
+
+template<typename Emit>
+void triples(std::span<const value_t> sorted, value_t target, Emit&& emit) {
+  for (size_t i = 0; i + 2 < sorted.size(); i++)
+    if (!triples_from(sorted, i, target, emit))
+      return;
+}
+
+/**
+ * Splits the smallest-entry indices of the triple search into chunks of roughly equal work (the sweep for index `i`
+ * costs `n - i`) and works through them on `n_threads` threads. Every chunk collects its triples in its own buffer,
+ * the buffers are reported in chunk order so the output is the same as for `triples`.
+ * With `first_only` threads stop picking up chunks past the earliest chunk that found a triple, and only its first
+ * triple is reported.
+ */
+template<typename Emit>
+void parallel_triples(std::span<const value_t> sorted, value_t target, Emit&& emit,
+                      bool first_only = false, size_t n_threads = std::thread::hardware_concurrency()) {
+  if (sorted.size() < 3)
+    return;
+  auto n = sorted.size();
+  n_threads = std::max<size_t>(n_threads, 1);
+
+  // chunk boundaries on the cumulative work, several chunks per thread to even out the sweeps' data dependence
+  auto n_chunks = std::min(8 * n_threads, n - 2);
+  auto total = static_cast<double>(n) * (n - 1) / 2;
+  auto bounds = std::vector<size_t> {0};
+  double work = 0;
+  for (size_t i = 0; i < n - 2; i++) {
+    work += n - i;
+    if (work >= total * bounds.size() / n_chunks && bounds.size() < n_chunks)
+      bounds.push_back(i + 1);
+  }
+  bounds.push_back(n - 2);
+  n_chunks = bounds.size() - 1;
+
+  using triple_t = std::array<value_t, 3>;
+  auto found = std::vector<std::vector<triple_t>>(n_chunks);
+  auto next = std::atomic<size_t> {0};
+  auto earliest = std::atomic<size_t> {n_chunks};
+
+  auto worker = [&]() {
+    for (auto c = next++; c < n_chunks && c < earliest; c = next++) {
+      auto& buffer = found[c];
+      auto collect = [&](std::span<const value_t> t) {
+        buffer.push_back({t[0], t[1], t[2]});
+        return !first_only;
+      };
+      for (auto i = bounds[c]; i < bounds[c + 1]; i++) {
+        if (!triples_from(sorted, i, target, collect))
+          break;
+        if (first_only && c > earliest)
+          break;
+      }
+      if (first_only && !buffer.empty()) {
+        for (auto e = earliest.load(); c < e && !earliest.compare_exchange_weak(e, c);) {}
+      }
+    }
+  };
+
+  {
+    std::vector<std::jthread> threads;
+    for (size_t t = 1; t < std::min(n_threads, n_chunks); t++)
+      threads.emplace_back(worker);
+    worker();
+  }
+
+  for (const auto& buffer : found)
+    for (const auto& t : buffer)
+      if (!report(emit, t) || first_only)
+        return;
+}
+
+/**
+ * Enumerates the combinations of `n` indices in `[from, sorted.size())` in canonical form: an entry equal to its
+ * predecessor is only used if the predecessor is used too, so equal values aren't reported more than once.
+ */
+template<typename Visit>
+bool combinations(std::span<const value_t> sorted, size_t from, size_t n, std::vector<size_t>& chosen, Visit& visit) {
+  if (n == 0)
+    return visit(chosen);
+  for (size_t i = from; i + n <= sorted.size(); i++) {
+    if (i > from && sorted[i-1] == sorted[i])
+      continue;
+    chosen.push_back(i);
+    auto more = combinations(sorted, i + 1, n - 1, chosen, visit);
+    chosen.pop_back();
+    if (!more)
+      return false;
+  }
+  return true;
+}
+
+/**
+ * Meet-in-the-middle for larger `k`: all canonical combinations of the first `k/2` entries are tabulated by their sum,
+ * then every combination of the remaining `k - k/2` entries looks up its complement. A left half only joins a right
+ * half that starts after it, which keeps every index combination (and thus every value combination) unique.
+ */
+template<typename Emit>
+void meet_in_the_middle(std::span<const value_t> sorted, value_t target, size_t k, Emit&& emit) {
+  auto left_k = k / 2, right_k = k - left_k;
+
+  struct half_t { size_t last; size_t offset; };
+  auto left_values = values_t {};
+  auto left = std::unordered_map<value_t, std::vector<half_t>> {};
+  auto chosen = std::vector<size_t> {};
+
+  auto tabulate = [&](const std::vector<size_t>& idx) {
+    value_t sum = 0;
+    auto offset = left_values.size();
+    for (auto i : idx) {
+      sum += sorted[i];
+      left_values.push_back(sorted[i]);
+    }
+    left[sum].push_back({idx.back(), offset});
+    return true;
+  };
+  combinations(sorted, 0, left_k, chosen, tabulate);
+
+  auto found = values_t (k);
+  auto join = [&](const std::vector<size_t>& idx) {
+    auto first = idx.front();
+    value_t sum = 0;
+    for (auto i : idx)
+      sum += sorted[i];
+    auto it = left.find(target - sum);
+    if (it == left.end())
+      return true;
+    auto continues_run = first > 0 && sorted[first-1] == sorted[first];
+    for (const auto& half : it->second) {
+      if (half.last >= first || (continues_run && half.last != first - 1))
+        continue;
+      std::copy_n(left_values.cbegin() + half.offset, left_k, found.begin());
+      for (size_t i = 0; i < right_k; i++)
+        found[left_k + i] = sorted[idx[i]];
+      if (!report(emit, found))
+        return false;
+    }
+    return true;
+  };
+  // the right half may start at any index; canonical form is checked against the left half in `join`
+  for (size_t first = left_k; first + right_k <= sorted.size(); first++) {
+    chosen.assign(1, first);
+    if (!combinations(sorted, first + 1, right_k - 1, chosen, join))
+      return;
+  }
+}
+
+/**
+ * Index over a sorted list for answering many targets: the value set, plus a histogram of all pair sums when the
+ * distinct values span a small enough range. The histogram answers "is there a pair summing to t" in O(1) and lets
+ * the triple search skip every smallest entry whose complement is not a pair sum at all.
+ */
+class index {
+public:
+  static constexpr value_t max_histogram_range = value_t{1} << 14;
+
+  explicit index(values_t values) : sorted{std::move(values)}, present{sorted} {
+    if (sorted.empty() || sorted.back() - sorted.front() >= max_histogram_range)
+      return;
+
+    lo = sorted.front();
+    auto counts = std::vector<uint64_t>(sorted.back() - lo + 1);
+    for (auto v : sorted)
+      counts[v - lo]++;
+    auto distinct = std::vector<value_t> {};
+    std::unique_copy(sorted.cbegin(), sorted.cend(), std::back_inserter(distinct));
+
+    pair_sums.resize(2 * counts.size() - 1);
+    for (size_t a = 0; a < distinct.size(); a++) {
+      auto ca = counts[distinct[a] - lo];
+      pair_sums[2 * (distinct[a] - lo)] += ca * (ca - 1) / 2;
+      for (size_t b = a + 1; b < distinct.size(); b++)
+        pair_sums[distinct[a] + distinct[b] - 2 * lo] += ca * counts[distinct[b] - lo];
+    }
+  }
+
+  [[nodiscard]] std::span<const value_t> values() const { return sorted; }
+
+  // number of index pairs summing to `s`, or nullopt without a histogram
+  [[nodiscard]] std::optional<uint64_t> pairs_summing_to(value_t s) const {
+    if (pair_sums.empty())
+      return std::nullopt;
+    auto i = s - 2 * lo;
+    return i >= 0 && i < static_cast<value_t>(pair_sums.size()) ? pair_sums[i] : 0;
+  }
+
+  template<typename Emit>
+  void pairs(value_t target, Emit&& emit) const {
+    if (pairs_summing_to(target).value_or(1) == 0)
+      return;
+    ksum::pairs(sorted, present, target, emit);
+  }
+
+  template<typename Emit>
+  void triples(value_t target, Emit&& emit) const {
+    for (size_t i = 0; i + 2 < sorted.size(); i++)
+      if (pairs_summing_to(target - sorted[i]).value_or(1) != 0)
+        if (!triples_from(std::span<const value_t>{sorted}, i, target, emit))
+          return;
+  }
+
+private:
+  values_t sorted;
+  value_set present;
+  value_t lo = 0;
+  std::vector<uint64_t> pair_sums;
+};
+
+// below this many entries the triple search isn't worth spreading over threads
+inline constexpr size_t parallel_threshold = 4096;
+
+template<typename Emit>
+void solve(std::span<const value_t> sorted, value_t target, size_t k, Emit&& emit, bool first_only = false) {
+  if (sorted.size() < k)
+    return;
+  auto once = [&](std::span<const value_t> values) {
+    return report(emit, values) && !first_only;
+  };
+  switch (k) {
+    case 2: pairs(sorted, target, once); break;
+    case 3:
+      if (sorted.size() >= parallel_threshold)
+        parallel_triples(sorted, target, emit, first_only);
+      else
+        triples(sorted, target, once);
+      break;
+    default: meet_in_the_middle(sorted, target, k, once); break;
+  }
+}
+
+template<typename Emit>
+void solve(const index& idx, value_t target, size_t k, Emit&& emit) {
+  switch (k) {
+    case 2: idx.pairs(target, emit); break;
+    case 3: idx.triples(target, emit); break;
+    default: solve(idx.values(), target, k, emit); break;
+  }
+}
+
+}
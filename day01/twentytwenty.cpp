@@ -1,20 +1,172 @@
+#include "ksum.hpp"
+#include "day05/watch.hpp"
+
+#include <atomic>
 #include <fstream>
 #include <vector>
 #include <algorithm>
 #include <iostream>
+#include <map>
+#include <optional>
 #include <ranges>
+#include <set>
+#include <span>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+auto print(std::ostream& os) {
+  return [&os](std::span<const ksum::value_t> values) {
+    ksum::value_t product = 1;
+    std::string names;
+    for (size_t n = 0; n < values.size(); n++) {
+      auto name = static_cast<char>('i' + n);
+      os << name << ": " << values[n] << ", ";
+      names += n ? "*" : "";
+      names += name;
+      product *= values[n];
+    }
+    os << names << ": " << product << "\n";
+  };
+}
+
+auto read_values(std::istream& is) {
+  ksum::values_t values;
+  for (std::string line; std::getline(is, line);)
+    if (!line.empty())
+      values.push_back(std::stoll(line));
+  return values;
+}
+
+auto read_values(std::span<const std::string> lines) {
+  ksum::values_t values;
+  for (const auto& line : lines)
+    if (!line.empty())
+      values.push_back(std::stoll(line));
+  return values;
+}
+
+/**
+ * Answers every target against one index. Targets are handed out to the threads one at a time and each answer is
+ * buffered, so the output is in the order of the targets file regardless of which thread answered it.
+ */
+void batch(const ksum::index& idx, const ksum::values_t& targets, const std::vector<size_t>& ks) {
+  auto answers = std::vector<std::string>(targets.size());
+  auto next = std::atomic<size_t> {0};
+
+  auto worker = [&]() {
+    for (auto t = next++; t < targets.size(); t = next++) {
+      std::ostringstream os;
+      os << "target: " << targets[t] << "\n";
+      for (auto k : ks)
+        ksum::solve(idx, targets[t], k, print(os));
+      answers[t] = os.str();
+    }
+  };
+
+  auto n_threads = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, targets.size());
+  std::vector<std::jthread> threads;
+  for (size_t i = 1; i < n_threads; i++)
+    threads.emplace_back(worker);
+  worker();
+  threads.clear();
+
+  for (const auto& a : answers)
+    std::cout << a;
+}
+
+/**
+ * The combinations found so far for every `k`, kept while values are appended: a new value only has to be combined
+ * with the values before it. A pair is one lookup in the counts of the values seen so far, a triple one lookup per
+ * distinct value. Larger `k` are solved again over all values.
+ */
+struct ledger_t {
+  ksum::value_t target;
+  std::vector<size_t> ks;
+  std::unordered_map<ksum::value_t, size_t> counts {};
+  std::map<size_t, std::set<ksum::values_t>> found {};
+
+  void append(std::span<const ksum::value_t> more) {
+    for (auto v : more) {
+      auto record = [&](size_t k, ksum::values_t combination) {
+        std::ranges::sort(combination);
+        found[k].insert(std::move(combination));
+      };
+      for (auto k : ks) {
+        if (k == 2 && counts.contains(target - v)) {
+          record(2, {target - v, v});
+        } else if (k == 3) {
+          // every pair `x <= y` of earlier values with `x + y == target - v`, found from `x`
+          for (auto [x, n] : counts) {
+            auto y = target - v - x;
+            if (y > x ? counts.contains(y) : y == x && n > 1)
+              record(3, {x, y, v});
+          }
+        }
+      }
+      counts[v]++;
+    }
+
+    for (auto k : ks) {
+      if (k < 4)
+        continue;
+      auto sorted = ksum::values_t {};
+      for (auto [x, n] : counts)
+        sorted.insert(sorted.end(), n, x);
+      std::ranges::sort(sorted);
+      found[k].clear();
+      ksum::solve(sorted, target, k, [&](std::span<const ksum::value_t> c) {
+        found[k].emplace(c.begin(), c.end());
+      });
+    }
+  }
+
+  void print(std::ostream& os, bool first_only) {
+    for (auto k : ks)
+      for (const auto& combination : found[k]) {
+        ::print(os)(combination);
+        if (first_only)
+          break;
+      }
+  }
+};
 
 auto main(int argc, char* argv[]) -> int {
   namespace ranges = std::ranges;
 
   constexpr auto twenty20 = 2020;
+  constexpr size_t max_k = 16;
+
+  // `--first` and `--watch` may go anywhere, the rest is positional
+  auto first_only = false, watch = false;
+  auto args = std::vector<char*> {};
+  for (auto arg : std::span(argv, argc)) {
+    if (std::string_view{arg} == "--first")
+      first_only = true;
+    else if (std::string_view{arg} == "--watch")
+      watch = true;
+    else
+      args.push_back(arg);
+  }
+  argc = static_cast<int>(args.size());
+  argv = args.data();
 
-  if (argc != 2) {
-    std::cout << "usage: " << argv[0] << " path-to-input" << std::endl;
+  auto queries = argc > 2 && std::string_view{argv[2]} == "--queries";
+  if (argc < 2 || argc > 4 + queries || (queries && argc < 4) || (queries && watch)) {
+    std::cout << "usage: " << argv[0] << " path-to-input [target] [k] [--first] [--watch]" << std::endl;
+    std::cout << "       " << argv[0] << " path-to-input --queries path-to-targets [k]" << std::endl;
     return 0;
   }
 
   std::string_view path = argv[1];
+  auto k_arg = queries ? 4 : 3;
+  ksum::value_t target = !queries && argc > 2 ? std::stoll(argv[2]) : twenty20;
+  auto k = argc > k_arg ? std::optional<size_t>{std::stoull(argv[k_arg])} : std::nullopt;
+
+  if (k && (*k < 2 || *k > max_k)) {
+    std::cout << "k should be in [2, " << max_k << "]" << std::endl;
+    return 1;
+  }
 
   auto file = std::ifstream{path.begin()};
 
@@ -23,54 +175,39 @@ auto main(int argc, char* argv[]) -> int {
     return 1;
   }
 
-  std::vector<std::string> tokens;
-  for (std::string line; std::getline(file, line);)
-    tokens.push_back(line);
+  // without `k`, answer both parts of the puzzle
+  auto ks = k ? std::vector<size_t>{*k} : std::vector<size_t>{2, 3};
 
-  std::vector<int> input (tokens.size());
-  std::ranges::transform(tokens, input.begin(), [](const auto& line){
-    return std::stoi(line);
-  });
+  if (watch) {
+    auto ledger = ledger_t { target, ks };
+    watch_lines(argv[1], [&](const auto& prev, const auto& next) {
+      // only appended values can be combined with the ones seen so far, anything else starts over
+      auto from = changed_lines(prev, next).append_only(prev.size()) ? prev.size() : 0;
+      auto more = read_values(std::span(next).subspan(from));
+      if (from == 0)
+        ledger = ledger_t { target, ks };
+      ledger.append(more);
+      std::cout << "Read " << next.size() - from << " of " << next.size() << " lines\n";
+      ledger.print(std::cout, first_only);
+    });
+  }
 
-  ranges::sort(input);
+  auto input = read_values(file);
 
-  struct ij { int i, j; };
-  std::vector<ij> matching_pairs;
-  // for all items `i`
-  for (auto i = input.cbegin(); i < input.cend(); i++) {
-    // determine whether `2020-i` is in the input
-    auto j = twenty20 - *i;
-    if (j >= 0 && std::binary_search(i, input.cend(), j) )
-      matching_pairs.emplace_back(ij{*i,j});
-  }
+  ranges::sort(input);
 
-  ranges::for_each(matching_pairs, [](const auto& ij){
-    auto& [i, j] = ij;
-    std::cout << "i: " << i << ", j: " << j << ", i*j: " << i*j << std::endl;
-  });
-
-  struct ijk { int i, j, k; };
-  std::vector<ijk> matching_triples;
-  // for all items `i`
-  for (auto i = input.cbegin(); i < input.cend(); i++) {
-    // find the upper bound `ub` s.t. `i+j <= 2020`
-    // and for all items `j` in the range `[i,ub]`
-    auto ub = std::upper_bound(i, input.cend(), twenty20 - *i);
-    for (auto j = i; j < ub; j++) {
-      // determine whether 2020-i-j is in the list
-      auto k = twenty20 - *i - *j;
-      if (k >= 0 && std::binary_search(j, ub, k))
-        matching_triples.emplace_back(ijk{*i, *j, k});
+  if (queries) {
+    auto targets_file = std::ifstream{argv[3]};
+    if (!targets_file.good()) {
+      std::cout << "Could not open " << argv[3] << std::endl;
+      return 1;
     }
+    auto targets = read_values(targets_file);
+    if (!targets.empty())
+      batch(ksum::index{std::move(input)}, targets, ks);
+    return 0;
   }
 
-  ranges::for_each(matching_triples, [](const auto& ijk){
-    auto& [i,j,k] = ijk;
-    std::cout <<
-              "i: " << i << ", " <<
-              "j: " << j << ", " <<
-              "k: " << k << ", " <<
-              "i*j*k: " << i*j*k << std::endl;
-  });
-
+  for (auto n : ks)
+    ksum::solve(input, target, n, print(std::cout), first_only);
 }
@@ -1,9 +1,140 @@
+#include <algorithm>
+#include <bit>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
 #include <vector>
-#include <ranges>
-#include <algorithm>
-#include <regex>
+
+#include "day05/records.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * The password database in structure-of-arrays layout: entry `i` is the policy `min[i]-max[i] ch[i]` and the password
+ * `buffer.substr(offset[i], length[i])`. Passwords aren't copied out of the input buffer.
+ * The buffer is padded so that a full vector can be loaded from the start of any password.
+ */
+struct database_t {
+  static constexpr size_t padding = 16;
+
+  std::string buffer;
+  std::vector<uint16_t> min {}, max {};
+  std::vector<char> ch {};
+  std::vector<size_t> offset {};
+  std::vector<uint16_t> length {};
+
+  [[nodiscard]] size_t size() const { return ch.size(); }
+};
+
+// "1-3 a: abcde", lines that don't match are skipped
+database_t parse(std::string buffer) {
+  auto db = database_t { std::move(buffer) };
+  const auto& b = db.buffer;
+  const auto n = b.size();
+
+  auto number = [&](size_t& pos, uint16_t& value) {
+    auto from = pos;
+    value = 0;
+    for (; pos < n && b[pos] >= '0' && b[pos] <= '9' && pos - from < 4; pos++)
+      value = value * 10 + (b[pos] - '0');
+    return pos > from;
+  };
+  auto expect = [&](size_t& pos, char c) {
+    return pos < n && b[pos] == c && ++pos;
+  };
+  auto word = [](char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+  };
+
+  for (size_t pos = 0; pos < n;) {
+    uint16_t min, max;
+    char ch;
+    auto ok = number(pos, min) && expect(pos, '-') && number(pos, max) && expect(pos, ' ')
+        && pos < n && word(ch = b[pos++]) && expect(pos, ':') && expect(pos, ' ');
+    auto from = pos;
+    if (ok) {
+      for (; pos < n && word(b[pos]); pos++) {}
+      ok = pos > from && (pos == n || b[pos] == '\n') && pos - from <= UINT16_MAX;
+    }
+    if (ok) {
+      db.min.push_back(min);
+      db.max.push_back(max);
+      db.ch.push_back(ch);
+      db.offset.push_back(from);
+      db.length.push_back(static_cast<uint16_t>(pos - from));
+    }
+    // on to the next line
+    for (; pos < n && b[pos] != '\n'; pos++) {}
+    pos++;
+  }
+
+  db.buffer.append(database_t::padding, '\0');
+  return db;
+}
+
+// occurrences of `ch` in `[p, p+len)`, may read up to 15 bytes past the end
+inline size_t count_char(const char* p, size_t len, char ch) {
+#if defined(__SSE2__)
+  auto needle = _mm_set1_epi8(ch);
+  size_t count = 0;
+  for (; len >= 16; p += 16, len -= 16) {
+    auto eq = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), needle);
+    count += std::popcount(static_cast<unsigned>(_mm_movemask_epi8(eq)));
+  }
+  if (len) {
+    auto eq = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), needle);
+    count += std::popcount(static_cast<unsigned>(_mm_movemask_epi8(eq)) & ((1u << len) - 1));
+  }
+  return count;
+#else
+  return std::count(p, p + len, ch);
+#endif
+}
+
+struct valid_t {
+  size_t one = 0, two = 0;
+};
+
+// both policies in one pass over entries `[from, to)`
+valid_t count_valid(const database_t& db, size_t from, size_t to) {
+  auto valid = valid_t {};
+  for (size_t i = from; i < to; i++) {
+    auto password = db.buffer.data() + db.offset[i];
+    auto ch = db.ch[i];
+    auto count = count_char(password, db.length[i], ch);
+    valid.one += count >= db.min[i] && count <= db.max[i];
+    auto at = [&](uint16_t pos) {
+      return pos >= 1 && pos <= db.length[i] && password[pos - 1] == ch;
+    };
+    valid.two += at(db.min[i]) != at(db.max[i]);
+  }
+  return valid;
+}
+
+// splits the entries in one chunk per thread and adds up their counts
+valid_t count_valid(const database_t& db) {
+  static constexpr size_t min_chunk = 1 << 16;
+  auto n_threads = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, db.size() / min_chunk + 1);
+  auto chunk = (db.size() + n_threads - 1) / n_threads;
+
+  auto ranges = std::vector<std::pair<size_t, size_t>> {};
+  for (size_t t = 0; t < n_threads; t++)
+    ranges.emplace_back(std::min(t * chunk, db.size()), std::min((t + 1) * chunk, db.size()));
+
+  return records::map_reduce<valid_t>(std::span<const std::pair<size_t, size_t>>(ranges), [&](auto range) {
+    return count_valid(db, range.first, range.second);
+  }, [](valid_t& acc, const valid_t& v) {
+    acc.one += v.one;
+    acc.two += v.two;
+  });
+}
 
 auto main(int argc, char* argv[]) -> int {
   if (argc != 2) {
@@ -13,59 +144,18 @@ auto main(int argc, char* argv[]) -> int {
 
   std::string_view path = argv[1];
 
-  auto file = std::ifstream{path.begin()};
+  auto file = std::ifstream{path.begin(), std::ios::binary};
 
   if (!file.good()) {
     std::cout << "Could not open " << path << std::endl;
     return 1;
   }
 
-  std::vector<std::string> tokens;
-  for (std::string line; std::getline(file, line);)
-    tokens.push_back(line);
+  auto db = parse(std::string { std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{} });
 
-  struct policy_t {
-    int min = 0, max = 0;
-    char ch = '\0';
-  };
-  using password_t = std::string;
+  auto valid = count_valid(db);
 
-  struct entry {
-    policy_t policy;
-    password_t password;
-  };
-
-  std::regex regex(R"((\d+)-(\d+)\s(\w): (\w+))");
-
-  std::vector<std::optional<entry>> opt_input (tokens.size());
-
-  std::ranges::transform(tokens, opt_input.begin(), [&regex](const auto& line) -> std::optional<entry> {
-    std::smatch match;
-    auto matched = std::regex_match(line, match, regex);
-    if(!matched || match.size() != 5) {
-      return std::nullopt;
-    }
-    int min = std::stoi(match[1].str());
-    int max = std::stoi(match[2].str());
-    char ch = match[3].str().begin()[0];
-    std::string pass = match[4].str();
-    return entry{ {min, max, ch}, pass };
-  });
-
-  auto condition_one = [](const std::optional<entry>& eo) {
-    if (!eo) return false;
-    auto e = *eo;
-    auto c_count = std::count_if(e.password.cbegin(), e.password.cend(), [&e](char c){ return c == e.policy.ch; } );
-    return c_count >= e.policy.min && c_count <= e.policy.max;
-  };
-
-  std::cout << "Valid, part 1: " << std::ranges::count_if(opt_input, condition_one) << std::endl;
-
-  auto condition_two = [](const std::optional<entry>& eo) {
-    if (!eo) return false;
-    auto e = *eo;
-    return (e.password[e.policy.min-1] == e.policy.ch) != (e.password[e.policy.max-1] == e.policy.ch);
-  };
+  std::cout << "Valid, part 1: " << valid.one << std::endl;
 
-  std::cout << "Valid, part 2: " << std::ranges::count_if(opt_input, condition_two) << std::endl;
+  std::cout << "Valid, part 2: " << valid.two << std::endl;
 }
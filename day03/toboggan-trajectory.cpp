@@ -1,12 +1,135 @@
-#include <array>
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <numeric>
 #include <optional>
+#include <string>
+#include <string_view>
 #include <vector>
 
+#include "day05/dispatch.hpp"
+
+struct slope_t {
+  size_t right, down;
+};
+
+/**
+ * The map as bit-packed rows, bit `col % 64` of word `col / 64` is set for a tree.
+ * `Words` is the number of 64-bit words per row, `std::dynamic_extent` to take it from `words`.
+ */
+template<size_t Words>
+struct tree_map_t {
+  size_t width = 0, words = 0, rows = 0;
+  std::vector<uint64_t> bits {};
+
+  [[nodiscard]] size_t stride() const {
+    if constexpr (Words == std::dynamic_extent)
+      return words;
+    else
+      return Words;
+  }
+
+  [[nodiscard]] bool tree(size_t row, size_t col) const {
+    return (bits[row * stride() + col / 64] >> (col % 64)) & 1u;
+  }
+
+  void push_row(const std::string& line) {
+    bits.resize(bits.size() + stride());
+    auto row = bits.end() - stride();
+    for (size_t col = 0; col < width; col++)
+      if (line[col] == '#')
+        row[col / 64] |= uint64_t{1} << (col % 64);
+    rows++;
+  }
+};
+
+/**
+ * Walks all slopes in a single pass over the rows, which are fed one at a time. Every slope keeps the next row it
+ * visits (its phase for down-steps > 1) and its column; the column advances by `right % width` and wraps with a
+ * subtraction instead of a modulo per step.
+ */
+class toboggans_t {
+public:
+  toboggans_t(const std::vector<slope_t>& slopes, size_t width) : width{width} {
+    for (const auto& s : slopes)
+      walkers.push_back({s.right % width, s.down});
+  }
+
+  // `tree(col)` tells whether the current row has a tree in column `col`
+  template<typename Tree>
+  void next_row(Tree&& tree) {
+    for (auto& w : walkers) {
+      if (w.next_row != row)
+        continue;
+      w.trees += tree(w.col);
+      w.next_row += w.down;
+      w.col += w.right;
+      if (w.col >= width)
+        w.col -= width;
+    }
+    row++;
+  }
+
+  [[nodiscard]] std::vector<size_t> trees() const {
+    std::vector<size_t> trees;
+    for (const auto& w : walkers)
+      trees.push_back(w.trees);
+    return trees;
+  }
+
+private:
+  struct walker_t { size_t right, down, next_row = 0, col = 0, trees = 0; };
+  std::vector<walker_t> walkers;
+  size_t width, row = 0;
+};
+
+template<size_t Words>
+std::vector<size_t> count_trees(const tree_map_t<Words>& map, const std::vector<slope_t>& slopes) {
+  auto toboggans = toboggans_t { slopes, map.width };
+  for (size_t row = 0; row < map.rows; row++)
+    toboggans.next_row([&](size_t col) { return map.tree(row, col); });
+  return toboggans.trees();
+}
+
+// counts trees while reading, only the current row is kept in memory
+std::optional<std::vector<size_t>> stream_trees(std::istream& is, std::string& line, const std::vector<slope_t>& slopes) {
+  const auto width = line.size();
+  auto toboggans = toboggans_t { slopes, width };
+  do {
+    if (line.size() != width) {
+      std::cerr << "unexpected row width" << std::endl;
+      return std::nullopt;
+    }
+    toboggans.next_row([&](size_t col) { return line[col] == '#'; });
+  } while (std::getline(is, line));
+  return toboggans.trees();
+}
+
+// "right,down", nullopt for anything else or a zero `down`
+std::optional<slope_t> parse_slope(std::string_view s) {
+  auto number = [](std::string_view n) -> std::optional<size_t> {
+    size_t value = 0;
+    auto [p, ec] = std::from_chars(n.data(), n.data() + n.size(), value);
+    if (ec != std::errc{} || p != n.data() + n.size())
+      return std::nullopt;
+    return value;
+  };
+  auto comma = s.find(',');
+  if (comma == std::string_view::npos)
+    return std::nullopt;
+  auto right = number(s.substr(0, comma));
+  auto down = number(s.substr(comma + 1));
+  if (!right || !down || *down == 0)
+    return std::nullopt;
+  return slope_t{*right, *down};
+}
+
 auto main(int argc, char* argv[]) -> int {
-  if (argc != 2) {
-    std::cout << "usage " << argv[0] << " path-to-input" << std::endl;
+  if (argc < 2) {
+    std::cout << "usage " << argv[0] << " path-to-input [--stream] [right,down ...]" << std::endl;
     return 0;
   }
 
@@ -19,42 +142,58 @@ auto main(int argc, char* argv[]) -> int {
     return 1;
   }
 
-  // read the map
-  static constexpr auto width = 31;
-  using row_type = std::array<char, width>;
-  std::vector<row_type> map;
-  for (std::string line; std::getline(file, line);) {
-    row_type row;
-    if (line.size() != width) {
-      std::cerr << "unexpected row width" << std::endl;
-      return 1;
+  std::vector<slope_t> slopes;
+  auto stream = false;
+  for (int i = 2; i < argc; i++) {
+    if (std::string_view{argv[i]} == "--stream") {
+      stream = true;
+      continue;
     }
-    std::copy_n(line.cbegin(), width, row.begin());
-    map.emplace_back(row);
-  }
-
-  // Traverse path
-  size_t left = 0, trees = 0;
-  for(const auto& row : map) {
-    if (row[left%width]=='#')
-      trees++;
-    left += 3;
-  }
-  std::cout << "Part 1: Encountered " << trees << " trees\n";
-
-  // Traverse and multiply paths
-  using right_down_type = std::pair<int, int>;
-  uint64_t multiplied = 1;
-  for (const auto& rd : { right_down_type {1,1}, {3,1}, {5,1}, {7,1}, {1,2} } ) {
-    left = 0, trees = 0;
-    for(size_t row = 0; row < map.size(); row += rd.second) {
-      if (map[row][left%width]=='#')
-        trees++;
-      left += rd.first;
+    auto slope = parse_slope(argv[i]);
+    if (!slope) {
+      std::cerr << "invalid slope " << argv[i] << ", expected right,down" << std::endl;
+      return 1;
     }
-    multiplied *= trees;
+    slopes.push_back(*slope);
   }
+  auto custom_slopes = !slopes.empty();
+  if (!custom_slopes)
+    slopes = { {3,1}, {1,1}, {5,1}, {7,1}, {1,2} };
+
+  std::string line;
+  if (!std::getline(file, line) || line.empty()) {
+    std::cerr << "empty map" << std::endl;
+    return 1;
+  }
+  const auto width = line.size(), words = (width + 63) / 64;
+
+  // read the map, rows of up to 64, 128 or 256 wide get a constant stride
+  auto trees = stream ? stream_trees(file, line, slopes) :
+      dispatch_size<1, 2, 4>(words, [&](auto n) -> std::optional<std::vector<size_t>> {
+        auto map = tree_map_t<decltype(n)::value> { width, words };
+        do {
+          if (line.size() != width) {
+            std::cerr << "unexpected row width" << std::endl;
+            return std::nullopt;
+          }
+          map.push_row(line);
+        } while (std::getline(file, line));
+        return count_trees(map, slopes);
+      });
+
+  if (!trees)
+    return 1;
+
+  if (custom_slopes || stream) {
+    for (size_t i = 0; i < slopes.size(); i++)
+      std::cout << "Right " << slopes[i].right << ", down " << slopes[i].down << ": " << (*trees)[i] << " trees\n";
+  }
+  if (!custom_slopes) {
+    std::cout << "Part 1: Encountered " << trees->front() << " trees\n";
+  }
+
+  auto multiplied = std::accumulate(trees->cbegin(), trees->cend(), uint64_t{1}, std::multiplies<>{});
 
   if (multiplied)
-    std::cout << "Part 2: Multiplied: " << multiplied << "\n";
+    std::cout << (custom_slopes ? "" : "Part 2: ") << "Multiplied: " << multiplied << "\n";
 }
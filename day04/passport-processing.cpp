@@ -1,69 +1,187 @@
-#include <cstring>
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
-#include <regex>
-#include <unordered_map>
-#include <variant>
-#include <vector>
+#include <string_view>
 #include <ranges>
 
+#include "day05/records.hpp"
+
 namespace ranges = std::ranges;
 
 enum class key_e {
   byr = 0, iyr, eyr, hgt, hcl, ecl, pid, cid
 };
 
-using keys_t = std::array<std::pair<const char*, key_e>, 8>;
-static constexpr auto keys = keys_t {
-    keys_t::value_type {"byr", key_e::byr},
-    {"iyr", key_e::iyr},
-    {"eyr", key_e::eyr},
-    {"hgt", key_e::hgt},
-    {"hcl", key_e::hcl},
-    {"ecl", key_e::ecl},
-    {"pid", key_e::pid},
-    {"cid", key_e::cid},
-};
+/**
+ * Allocation-free field validators, `v` is the value without its key.
+ */
+namespace validate {
 
-constexpr auto ke(const char* k) -> key_e {
-  return ranges::find_if_not(keys, [&k](const auto& p){
-    return std::strcmp(p.first, k);
-  })->second;
-};
+constexpr bool digits(std::string_view v) {
+  return !v.empty() && ranges::all_of(v, [](char c) { return c >= '0' && c <= '9'; });
+}
 
-struct min_max { int min, max; };
-struct height_range {
-  static constexpr min_max range_cm {150, 193 }, range_in {59, 76 };
-};
-struct hex_color {};
-struct eye_color {
-  static constexpr std::array<const char*, 7> in { "amb", "blu", "brn", "gry", "grn", "hzl", "oth" };
+constexpr int number(std::string_view v) {
+  int n = 0;
+  for (auto c : v)
+    n = n * 10 + (c - '0');
+  return n;
+}
+
+constexpr bool number_in(std::string_view v, int min, int max) {
+  return digits(v) && v.size() <= 9 && number(v) >= min && number(v) <= max;
+}
+
+constexpr bool year_in(std::string_view v, int min, int max) {
+  return v.size() == 4 && number_in(v, min, max);
+}
+
+constexpr bool height(std::string_view v) {
+  if (v.size() < 3)
+    return false;
+  auto unit = v.substr(v.size() - 2), n = v.substr(0, v.size() - 2);
+  if (unit == "cm")
+    return number_in(n, 150, 193);
+  if (unit == "in")
+    return number_in(n, 59, 76);
+  return false;
+}
+
+constexpr bool hex_color(std::string_view v) {
+  return v.size() == 7 && v[0] == '#' && ranges::all_of(v.substr(1), [](char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+  });
+}
+
+constexpr bool eye_color(std::string_view v) {
+  constexpr std::array<std::string_view, 7> colors { "amb", "blu", "brn", "gry", "grn", "hzl", "oth" };
+  return ranges::find(colors, v) != colors.cend();
+}
+
+constexpr bool passport_id(std::string_view v) {
+  return v.size() == 9 && digits(v);
+}
+
+}
+
+struct field_t {
+  std::string_view key;
+  key_e e;
+  bool required;
+  bool (*valid)(std::string_view);
 };
-struct passport_id {};
-struct country_id {};
-
-using rule_t = std::variant<min_max, height_range, hex_color, eye_color, passport_id, country_id>;
-using rules_t = std::array<std::pair<key_e, rule_t>, 8>;
-
-static constexpr auto rules = rules_t {
-    rules_t::value_type {key_e::byr, min_max{1920, 2002}},
-    {key_e::iyr, min_max{2010, 2020}},
-    {key_e::eyr, min_max{2020, 2030}},
-    {key_e::hgt, height_range{}},
-    {key_e::hcl, hex_color{}},
-    {key_e::ecl, eye_color{}},
-    {key_e::pid, passport_id{}},
-    {key_e::cid, country_id{}},
+
+// the passport schema: every field, whether it's required and how its value is validated
+static constexpr auto schema = std::array<field_t, 8> {
+    field_t {"byr", key_e::byr, true, [](std::string_view v) { return validate::year_in(v, 1920, 2002); }},
+    {"iyr", key_e::iyr, true, [](std::string_view v) { return validate::year_in(v, 2010, 2020); }},
+    {"eyr", key_e::eyr, true, [](std::string_view v) { return validate::year_in(v, 2020, 2030); }},
+    {"hgt", key_e::hgt, true, validate::height},
+    {"hcl", key_e::hcl, true, validate::hex_color},
+    {"ecl", key_e::ecl, true, validate::eye_color},
+    {"pid", key_e::pid, true, validate::passport_id},
+    {"cid", key_e::cid, false, [](std::string_view) { return true; }},
 };
 
-static constexpr auto rule(key_e e) -> rule_t {
-  return ranges::find_if(rules, [&e](const auto& er) { return er.first == e; })->second;
+/**
+ * Perfect hash over the three-letter keys: a multiplicative hash whose multiplier is searched at compile time such that
+ * every key in the schema lands in its own slot of a 16-entry table.
+ */
+namespace key_hash {
+
+constexpr size_t bits = 4, slots = 1u << bits;
+static constexpr uint8_t empty = 0xff;
+
+constexpr uint32_t hash(std::string_view k, uint32_t multiplier) {
+  if (k.size() != 3)
+    return 0;
+  auto packed = uint32_t(uint8_t(k[0])) << 16 | uint32_t(uint8_t(k[1])) << 8 | uint8_t(k[2]);
+  return (packed * multiplier) >> (32 - bits);
+}
+
+constexpr uint32_t find_multiplier() {
+  for (uint32_t m = 0x9e3779b1; ; m += 2) {
+    std::array<bool, slots> used {};
+    bool collision = false;
+    for (const auto& f : schema) {
+      auto h = hash(f.key, m);
+      collision |= used[h];
+      used[h] = true;
+    }
+    if (!collision)
+      return m;
+  }
+}
+
+static constexpr auto multiplier = find_multiplier();
+
+static constexpr auto table = []() {
+  std::array<uint8_t, slots> t {};
+  t.fill(empty);
+  for (size_t i = 0; i < schema.size(); i++)
+    t[hash(schema[i].key, multiplier)] = static_cast<uint8_t>(i);
+  return t;
+}();
+
 }
 
-// std::visit overload helper from cppreference.com
-template<class... Ts> struct overloaded : Ts... { using Ts::operator()...; };
-// explicit deduction guide (not needed as of C++20)
-template<class... Ts> overloaded(Ts...) -> overloaded<Ts...>;
+// the schema entry for `key`, nullptr for unknown keys
+constexpr const field_t* field(std::string_view key) {
+  auto i = key_hash::table[key_hash::hash(key, key_hash::multiplier)];
+  if (i == key_hash::empty || schema[i].key != key)
+    return nullptr;
+  return &schema[i];
+}
+
+static_assert(ranges::all_of(std::views::iota(size_t{0}, schema.size()), [](auto i) {
+  return static_cast<size_t>(schema[i].e) == i;
+}), "schema should be ordered by key_e");
+
+static_assert(field("hgt")->e == key_e::hgt);
+static_assert(field("cid")->e == key_e::cid);
+static_assert(field("xyz") == nullptr);
+static_assert(field("hgt")->valid("60in") && !field("hgt")->valid("190in"));
+static_assert(field("hcl")->valid("#123abc") && !field("hcl")->valid("#123abz"));
+
+/**
+ * A passport as views into the input buffer, indexed by `key_e`, plus a bit per key that is present.
+ */
+struct passport_t {
+  std::array<std::string_view, schema.size()> fields;
+  uint8_t present = 0;
+
+  static constexpr uint8_t required = []() {
+    uint8_t mask = 0;
+    for (const auto& f : schema)
+      if (f.required)
+        mask |= 1u << static_cast<size_t>(f.e);
+    return mask;
+  }();
+
+  // unknown keys are ignored
+  void set(std::string_view key, std::string_view value) {
+    if (auto f = field(key)) {
+      auto i = static_cast<size_t>(f->e);
+      fields[i] = value;
+      present |= 1u << i;
+    }
+  }
+
+  [[nodiscard]] bool complete() const {
+    return (present & required) == required;
+  }
+
+  [[nodiscard]] bool valid() const {
+    if (!complete())
+      return false;
+    for (size_t i = 0; i < schema.size(); i++)
+      if ((present >> i & 1u) && !schema[i].valid(fields[i]))
+        return false;
+    return true;
+  }
+};
 
 auto main(int argc, char* argv[]) -> int {
   if (argc != 2) {
@@ -80,79 +198,31 @@ auto main(int argc, char* argv[]) -> int {
     return 1;
   }
 
-  using tokens_t = std::vector<std::vector<std::pair<std::string, std::string>>>;
-  auto tokens = tokens_t {};
-
-  tokens_t::value_type line_tokens;
-  for (std::string line; std::getline(file, line);) {
-    if (line.empty()) {
-      tokens.push_back(line_tokens);
-      line_tokens.clear();
-    }
-    std::stringstream line_s { line };
-    for (std::string key_val; std::getline(line_s, key_val, ' ');) {
-      auto del = key_val.find(':');
-      if (del == std::string::npos)
-        break;
-      line_tokens.push_back(tokens_t::value_type::value_type {
-        std::string_view {key_val.c_str(), del},
-        std::string_view {key_val.c_str()+del+1}});
-    }
-  }
-  if (!line_tokens.empty())
-    tokens.push_back(line_tokens);
-
-  // part 1
-  auto p1_validator = [](const auto& p) {
-    for (auto ke : keys) {
-      if (ke.second == key_e::cid)
-        continue; // don't need to validate
-      if (ranges::find_if(p, [&ke](const auto& kv){
-        return kv.first == ke.first;
-      }) == p.cend())
-        return false;
-    }
-    return true;
-  };
-  std::cout << "Part 1: " << ranges::count_if(tokens, p1_validator) << " valid\n";
-
-  // part 2
-  auto p2_validator = [&p1_validator](const auto& p){
-    if (!p1_validator(p))
-      return false;
-
-    for (const auto& kv : p) {
-      std::string v = kv.second;
-      auto e = ke(kv.first.c_str());
-      auto r = rule(e);
-      if(!std::visit(overloaded {
-          [](auto) { return true; }, // unknown rules automatically pass
-          [&v](min_max r) {
-            auto i = std::stoi(v);
-            return i >= r.min && i <= r.max;
-          },
-          [&v](height_range r) {
-            auto in_pos = v.find("in"), cm_pos = v.find("cm");
-            auto exp = v.size()-2; // expect in or cm to be the last two chars
-            if (in_pos != exp && cm_pos != exp)
-              return false;
-            auto range = in_pos != std::string::npos ? height_range::range_in : height_range::range_cm;
-            auto i = std::stoi(std::string {v.c_str(), in_pos != std::string::npos ? in_pos : cm_pos});
-            return i >= range.min && i <= range.max;
-          },
-          [&v](hex_color r) {
-            return std::regex_match(v, std::regex{"^#[0-9,a-f]{6}$"});
-          },
-          [&v](eye_color r) {
-            return ranges::find(eye_color::in, v) != eye_color::in.cend();
-          },
-          [&v](passport_id r) {
-            return std::regex_match(v, std::regex{"^[0-9]{9}$"});
-          }
-      }, r)) { return false; }
-    }
-    return true;
-  };
-  std::cout << "Part 2: " << ranges::count_if(tokens, p2_validator) << " valid\n";
-
+  struct valid_t { size_t p1 = 0, p2 = 0; };
+
+  auto buffer = records::read_all(file);
+  auto valid = records::map_reduce<valid_t>(buffer, [](std::string_view chunk) {
+    auto counts = valid_t {};
+    records::for_each(chunk, [&](std::string_view record) {
+      auto passport = passport_t {};
+      size_t from = 0;
+      while (from < record.size()) {
+        auto to = std::min(record.find_first_of(" \n", from), record.size());
+        auto key_val = record.substr(from, to - from);
+        auto del = key_val.find(':');
+        if (del != std::string_view::npos)
+          passport.set(key_val.substr(0, del), key_val.substr(del + 1));
+        from = to + 1;
+      }
+      counts.p1 += passport.complete();
+      counts.p2 += passport.valid();
+    });
+    return counts;
+  }, [](valid_t& acc, const valid_t& v) {
+    acc.p1 += v.p1;
+    acc.p2 += v.p2;
+  });
+
+  std::cout << "Part 1: " << valid.p1 << " valid\n";
+  std::cout << "Part 2: " << valid.p2 << " valid\n";
 }
\ No newline at end of file
@@ -1,54 +1,187 @@
 #include "arg_input.hpp"
-#include "tokenize.hpp"
 
-#include <algorithm>
-#include <ranges>
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
 
-namespace ranges = std::ranges;
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
-auto main(int argc, char* argv[]) -> int {
-  auto file = get_input(argc, argv);
+constexpr size_t code_length = 10;
+constexpr size_t n_seats = 1024;
 
-  if (std::holds_alternative<int>(file))
-    return std::get<int>(file);
+// the codes read most significant bit first, indexed by the bits in reading order (first character in bit 0)
+constexpr auto reversed = []() {
+  std::array<uint16_t, n_seats> table {};
+  for (size_t i = 0; i < n_seats; i++)
+    for (size_t b = 0; b < code_length; b++)
+      if (i >> b & 1u)
+        table[i] |= 1u << (code_length - 1 - b);
+  return table;
+}();
 
-  auto &input = std::get<std::ifstream>(file);
+/**
+ * Seat ID of the 10 characters at `p`, may read up to 6 bytes past the code.
+ * 'B' and 'R' are the only code characters with bit 2 clear ('F' 0x46, 'L' 0x4c, 'B' 0x42, 'R' 0x52), so every
+ * character's bit is picked out at once and the code never branches on a character.
+ */
+inline uint16_t decode(const char* p) {
+#if defined(__SSE2__)
+  auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  // move bit 2 of every byte into its sign bit
+  auto bits = ~static_cast<unsigned>(_mm_movemask_epi8(_mm_slli_epi16(chars, 5))) & (n_seats - 1);
+  return reversed[bits];
+#else
+  uint16_t id = 0;
+  for (size_t i = 0; i < code_length; i++)
+    id = static_cast<uint16_t>(id << 1u | (~p[i] >> 2 & 1u));
+  return id;
+#endif
+}
+
+// seat IDs of all lines that are exactly one code long, other lines are skipped
+std::vector<uint16_t> decode_seats(std::string buffer) {
+  const auto n = buffer.size();
+  buffer.append(16, '\0');
+
+  auto seats = std::vector<uint16_t>{};
+  seats.reserve(n / (code_length + 1) + 1);
+  for (size_t from = 0; from < n;) {
+    auto to = std::min(buffer.find('\n', from), n);
+    if (to - from == code_length)
+      seats.push_back(decode(buffer.data() + from));
+    from = to + 1;
+  }
+  return seats;
+}
+
+// xor of all IDs in `[0, n]`
+constexpr unsigned xor_upto(unsigned n) {
+  switch (n % 4) {
+    case 0: return n;
+    case 1: return 1;
+    case 2: return n + 1;
+    default: return 0;
+  }
+}
+
+/**
+ * Occupancy of the whole plane, the seat space is small enough that nothing needs sorting. The state has a fixed size
+ * however many passes are added, so it can follow a feed that never ends.
+ */
+struct seats_t {
+  std::bitset<n_seats> taken;
+  uint16_t min = n_seats - 1, max = 0;
+  uint16_t ids_xor = 0, distinct = 0;
+
+  void add(uint16_t id) {
+    if (taken[id])
+      return;
+    taken.set(id);
+    min = std::min(min, id);
+    max = std::max(max, id);
+    ids_xor ^= id;
+    distinct++;
+  }
+
+  // calls `f` with every free seat between the lowest and the highest taken one
+  template<typename F>
+  void missing(F&& f) const {
+    if (!distinct)
+      return;
+    auto span = max - min + 1u;
+    if (distinct == span)
+      return;
+    // a single gap is what the xor of the taken IDs lacks from the xor of the whole range
+    if (distinct + 1u == span)
+      return f(static_cast<uint16_t>(xor_upto(max) ^ xor_upto(min ? min - 1u : 0) ^ ids_xor));
+    for (size_t id = min + 1u; id < max; id++)
+      if (!taken[id])
+        f(static_cast<uint16_t>(id));
+  }
 
-  auto tokens = tokenize(input);
+  // lowest free seat with both neighbours taken, 0 if there is none
+  [[nodiscard]] uint16_t mine() const {
+    for (size_t id = 1; id + 1 < n_seats; id++)
+      if (!taken[id] && taken[id - 1] && taken[id + 1])
+        return static_cast<uint16_t>(id);
+    return 0;
+  }
+};
 
-  tokens
-      .erase(std::remove_if(tokens.begin(), tokens.end(), [](const auto &t) { return t.size() != 10; }), tokens.end());
+void report(std::ostream& os, size_t passes, const std::map<std::string, seats_t, std::less<>>& flights) {
+  os << "after " << passes << " passes\n";
+  for (const auto& [key, seats] : flights) {
+    os << (key.empty() ? "" : key + ": ") << "highest seat ID: " << seats.max << ", missing:";
+    seats.missing([&](uint16_t id) { os << " " << id; });
+    os << "\n";
+  }
+  os.flush();
+}
 
-  struct boarding_pass {
-    std::string input;
-    uint row, column, seat_id;
-  };
+/**
+ * Reads passes as they come, one "code" or "flight code" per line, and reports every flight after each `checkpoint`
+ * passes and at the end of the feed. Only the per-flight seat maps are kept.
+ */
+void stream_seats(std::istream& is, size_t checkpoint) {
+  auto flights = std::map<std::string, seats_t, std::less<>>{};
+  size_t passes = 0;
+  for (std::string line; std::getline(is, line);) {
+    if (line.size() < code_length || (line.size() > code_length && line[line.size() - code_length - 1] != ' '))
+      continue;
+    auto key = std::string_view{line}.substr(0, line.size() - std::min(line.size(), code_length + 1));
+    char code[16] = {};
+    line.copy(code, code_length, line.size() - code_length);
 
-  auto boarding_passes = std::vector<boarding_pass>(tokens.size());
+    auto it = flights.find(key);
+    if (it == flights.end())
+      it = flights.emplace(key, seats_t{}).first;
+    it->second.add(decode(code));
 
-  ranges::transform(tokens, boarding_passes.begin(), [](const auto &token) -> boarding_pass {
-    uint16_t number = 0;
-    ranges::for_each(token, [&number](char c) {
-      number <<= 1u;
-      number |= (c == 'B' || c == 'R') ? 1u : 0u;
-    });
-    uint row = (number >> 3u), col = number & 0b111u;
-    return {token, row, col, row * 8 + col};
-  });
+    if (++passes % checkpoint == 0)
+      report(std::cout, passes, flights);
+  }
+  if (passes % checkpoint != 0)
+    report(std::cout, passes, flights);
+}
 
-  ranges::sort(boarding_passes, [](const auto &bp1, const auto &bp2) {
-    return bp1.seat_id < bp2.seat_id;
-  });
+auto main(int argc, char* argv[]) -> int {
+  auto stream = argc > 2 && std::string_view{argv[2]} == "--stream";
+  if (argc > 2 + 2 * stream || (argc > 2 && !stream)) {
+    std::cout << "usage " << argv[0] << " path-to-input [--stream [checkpoint-every]]" << std::endl;
+    return 0;
+  }
 
-  std::cout << "Part 1: highest seat ID: " << boarding_passes.back().seat_id << std::endl;
+  auto file = get_input(argc, argv);
 
-  uint id = 0;
-  for (auto it = boarding_passes.cbegin() + 1; it < boarding_passes.cend(); it++) {
-    if (it->seat_id - (it - 1)->seat_id == 2) {
-      id = it->seat_id - 1u;
-      break;
+  if (std::holds_alternative<int>(file))
+    return std::get<int>(file);
+
+  auto &input = std::get<std::ifstream>(file);
+
+  if (stream) {
+    auto checkpoint = argc > 3 ? std::stoull(argv[3]) : 1000;
+    if (checkpoint == 0) {
+      std::cerr << "checkpoint should be positive" << std::endl;
+      return 1;
     }
+    stream_seats(input, checkpoint);
+    return 0;
   }
-  std::cout << "Part 2: my ID: " << id << std::endl;
 
-}
\ No newline at end of file
+  auto ids = decode_seats(std::string { std::istreambuf_iterator<char>{input}, std::istreambuf_iterator<char>{} });
+
+  auto seats = seats_t {};
+  for (auto id : ids)
+    seats.add(id);
+
+  std::cout << "Part 1: highest seat ID: " << seats.max << std::endl;
+
+  std::cout << "Part 2: my ID: " << seats.mine() << std::endl;
+
+}
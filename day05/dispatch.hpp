@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Maps a size that is only known at runtime onto a template instantiation.
+ * `f` is called with `std::integral_constant<size_t, N>` for the `N` in `Sizes...` that equals `n`, so loops over `N`
+ * can be unrolled and strides become constants. Any other `n` calls `f` with
+ * `std::integral_constant<size_t, std::dynamic_extent>`, which should select a generic code path.
+ */
+template<typename F>
+constexpr decltype(auto) dispatch_size(size_t, F&& f) {
+  return f(std::integral_constant<size_t, std::dynamic_extent>{});
+}
+
+template<size_t N, size_t... Sizes, typename F>
+constexpr decltype(auto) dispatch_size(size_t n, F&& f) {
+  if (n == N)
+    return f(std::integral_constant<size_t, N>{});
+  return dispatch_size<Sizes...>(n, std::forward<F>(f));
+}
+
+template<size_t From, size_t... I, typename F>
+constexpr decltype(auto) dispatch_size_range(size_t n, F&& f, std::index_sequence<I...>) {
+  return dispatch_size<(From + I)...>(n, std::forward<F>(f));
+}
+
+// dispatch over every size in [From, To]
+template<size_t From, size_t To, typename F>
+constexpr decltype(auto) dispatch_size_range(size_t n, F&& f) {
+  static_assert(From <= To);
+  return dispatch_size_range<From>(n, std::forward<F>(f), std::make_index_sequence<To - From + 1>{});
+}
+
+static_assert(dispatch_size<1, 2>(2, [](auto n) { return decltype(n)::value; }) == 2);
+static_assert(dispatch_size<1, 2>(3, [](auto n) { return decltype(n)::value; }) == std::dynamic_extent);
+static_assert(dispatch_size_range<4, 8>(6, [](auto n) { return decltype(n)::value; }) == 6);
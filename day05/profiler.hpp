@@ -0,0 +1,225 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <csignal>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <ucontext.h>
+
+/**
+ * Opt-in sampling profiler. Set `AOC_PROFILE` to an output directory (and optionally `AOC_PROFILE_HZ`) and every
+ * program that includes this header samples its stack on `SIGPROF`. On exit it writes one folded-stack file per phase,
+ * `{dir}/{program}.{phase}.folded`, ready for flamegraph.pl or speedscope.
+ *
+ * Mark phases with a scoped `profiler::phase p {"part1"};`, samples outside any phase go to `main`.
+ *
+ * The handler walks the frame pointer chain from the interrupted context, so targets that include this header are built
+ * with `-fno-omit-frame-pointer` (and export their symbols for `dladdr`), see `aoc_profiled` in CMakeLists.txt. Only the
+ * main thread's stack is walked: samples taken on other threads keep just the interrupted instruction, and a sample
+ * that lands in code built without frame pointers (most of libc) usually loses its callers.
+ */
+namespace profiler {
+
+inline constexpr size_t max_depth = 48;
+inline constexpr size_t max_samples = 1 << 15;
+
+struct sample_t {
+  uint8_t phase;
+  uint8_t depth;
+  void* frames[max_depth];
+};
+
+inline std::unique_ptr<sample_t[]> samples;
+inline std::atomic<size_t> sampled {0};
+inline std::atomic<uint8_t> current_phase {0};
+inline std::vector<std::string> phases {"main"};
+// the main thread's stack `[stack_bottom, stack_top)`, the only one the frame walk reads
+inline uintptr_t stack_bottom = 0, stack_top = 0;
+
+/**
+ * Async-signal-safe: only reads the interrupted registers and, for a sample on the main thread, the stack between the
+ * interrupted stack pointer and `stack_top`, and only writes preallocated memory. Each frame record is `{saved frame pointer, return address}`, and the saved frame pointers have
+ * to climb strictly towards the top, so a corrupt chain ends the walk instead of looping or faulting.
+ */
+inline void on_sigprof(int, siginfo_t*, void* context) {
+  auto i = sampled.fetch_add(1, std::memory_order_relaxed);
+  if (i >= max_samples)
+    return;
+  auto& s = samples[i];
+  s.phase = current_phase.load(std::memory_order_relaxed);
+  s.depth = 0;
+
+  const auto& mc = static_cast<const ucontext_t*>(context)->uc_mcontext;
+#if defined(__x86_64__)
+  auto pc = static_cast<uintptr_t>(mc.gregs[REG_RIP]);
+  auto sp = static_cast<uintptr_t>(mc.gregs[REG_RSP]), fp = static_cast<uintptr_t>(mc.gregs[REG_RBP]);
+#elif defined(__aarch64__)
+  auto pc = static_cast<uintptr_t>(mc.pc);
+  auto sp = static_cast<uintptr_t>(mc.sp), fp = static_cast<uintptr_t>(mc.regs[29]);
+#else
+  uintptr_t pc = 0, sp = 0, fp = 0;
+#endif
+  if (!pc)
+    return;
+  s.frames[s.depth++] = reinterpret_cast<void*>(pc);
+
+  // other threads' stacks lie outside, their frame pointers aren't followed
+  if (sp < stack_bottom || sp >= stack_top)
+    return;
+  while (s.depth < max_depth && fp >= sp && fp + 2 * sizeof(uintptr_t) <= stack_top && fp % sizeof(uintptr_t) == 0) {
+    auto record = reinterpret_cast<const uintptr_t*>(fp);
+    if (!record[1])
+      break;
+    // the return address points after the call, step back into it so it resolves to the caller's line
+    s.frames[s.depth++] = reinterpret_cast<void*>(record[1] - 1);
+    if (record[0] <= fp)
+      break;
+    fp = record[0];
+  }
+}
+
+inline bool enabled() { return static_cast<bool>(samples); }
+
+class phase {
+public:
+  explicit phase(std::string_view name) : prev{current_phase.load()} {
+    if (!enabled())
+      return;
+    auto it = std::find(phases.cbegin(), phases.cend(), name);
+    if (it == phases.cend() && phases.size() < 256)
+      it = phases.insert(phases.cend(), std::string{name});
+    current_phase = static_cast<uint8_t>(it == phases.cend() ? 0 : it - phases.cbegin());
+  }
+  phase(const phase&) = delete;
+  phase& operator=(const phase&) = delete;
+  ~phase() { current_phase = prev; }
+private:
+  uint8_t prev;
+};
+
+inline std::string symbolize(void* addr) {
+  Dl_info info {};
+  if (!dladdr(addr, &info))
+    return "??";
+  if (!info.dli_sname) {
+    auto module = std::filesystem::path{info.dli_fname ? info.dli_fname : "??"}.filename().string();
+    auto offset = reinterpret_cast<uintptr_t>(addr) - reinterpret_cast<uintptr_t>(info.dli_fbase);
+    char hex[32];
+    std::snprintf(hex, sizeof hex, "+0x%zx", static_cast<size_t>(offset));
+    return module + hex;
+  }
+
+  int status = 0;
+  auto demangled = std::unique_ptr<char, decltype(&std::free)> {
+    abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status), &std::free };
+  std::string name = status == 0 ? demangled.get() : info.dli_sname;
+
+  // drop the parameter list, it makes the graph unreadable; keep template arguments and lambda names intact
+  int nest = 0;
+  for (size_t i = 0; i < name.size(); i++) {
+    auto c = name[i];
+    if (c == '<' || c == '{' || c == '[') nest++;
+    else if (c == '>' || c == '}' || c == ']') nest--;
+    else if (c == '(' && nest == 0 && i > 0) { name.resize(i); break; }
+  }
+  for (auto& c : name)
+    if (c == ';') c = ':';
+  return name;
+}
+
+inline void write(const std::filesystem::path& dir, std::string_view program) {
+  auto n = std::min<size_t>(sampled, max_samples);
+  auto names = std::map<void*, std::string> {};
+  auto folded = std::vector<std::map<std::string, size_t>>(phases.size());
+
+  for (size_t i = 0; i < n; i++) {
+    const auto& s = samples[i];
+    std::string stack;
+    for (size_t f = s.depth; f-- > 0;) {
+      auto [it, inserted] = names.try_emplace(s.frames[f]);
+      if (inserted)
+        it->second = symbolize(s.frames[f]);
+      if (!stack.empty())
+        stack += ';';
+      stack += it->second;
+    }
+    folded[s.phase][stack]++;
+  }
+
+  std::filesystem::create_directories(dir);
+  for (size_t p = 0; p < phases.size(); p++) {
+    if (folded[p].empty())
+      continue;
+    auto out = std::ofstream { dir / (std::string{program} + "." + phases[p] + ".folded") };
+    for (const auto& [stack, count] : folded[p])
+      out << stack << " " << count << "\n";
+  }
+}
+
+struct session_t {
+  std::filesystem::path dir;
+
+  session_t() {
+    auto env = std::getenv("AOC_PROFILE");
+    if (!env || !*env)
+      return;
+    dir = env;
+
+    auto hz_env = std::getenv("AOC_PROFILE_HZ");
+    long hz = hz_env ? std::strtol(hz_env, nullptr, 10) : 997;
+    if (hz <= 0 || hz > 100000)
+      hz = 997;
+
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+      void* addr = nullptr;
+      size_t size = 0;
+      if (pthread_attr_getstack(&attr, &addr, &size) == 0) {
+        stack_bottom = reinterpret_cast<uintptr_t>(addr);
+        stack_top = stack_bottom + size;
+      }
+      pthread_attr_destroy(&attr);
+    }
+
+    samples = std::make_unique<sample_t[]>(max_samples);
+
+    struct sigaction sa {};
+    sa.sa_sigaction = on_sigprof;
+    sa.sa_flags = SA_RESTART | SA_SIGINFO;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGPROF, &sa, nullptr);
+
+    auto us = 1000000 / hz;
+    auto period = timeval { us / 1000000, static_cast<suseconds_t>(us % 1000000) };
+    auto timer = itimerval { period, period };
+    setitimer(ITIMER_PROF, &timer, nullptr);
+  }
+
+  ~session_t() {
+    if (!enabled())
+      return;
+    auto off = itimerval {};
+    setitimer(ITIMER_PROF, &off, nullptr);
+    signal(SIGPROF, SIG_IGN);
+    write(dir, program_invocation_short_name);
+  }
+};
+
+inline session_t session;
+
+}
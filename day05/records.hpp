@@ -0,0 +1,196 @@
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <istream>
+#include <iterator>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * Pipeline for inputs made of records separated by blank lines (passports, customs groups, ...).
+ * The buffer is cut into chunks that end on a record boundary, the chunks are processed on worker threads and their
+ * results are reduced in chunk order.
+ */
+namespace records {
+
+inline std::string read_all(std::istream& is) {
+  return { std::istreambuf_iterator<char>{is}, std::istreambuf_iterator<char>{} };
+}
+
+/**
+ * A whole input file, memory-mapped so that inputs of several GB are paged in by the chunks that read them instead of
+ * being copied onto the heap first. At least `padding` zero bytes past the end are readable, for block loads that run
+ * over the last line: the file is mapped over an anonymous mapping that is that much longer.
+ * Anything that can't be mapped (a pipe, an empty file) is read into memory instead.
+ */
+class mapped_file {
+public:
+  static constexpr size_t padding = 16;
+
+  explicit mapped_file(const char* path) {
+    if (auto fd = ::open(path, O_RDONLY); fd >= 0) {
+      struct stat st {};
+      if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        auto size = static_cast<size_t>(st.st_size);
+        auto page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        length = (size + padding + page - 1) / page * page;
+        base = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base != MAP_FAILED && ::mmap(base, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) != MAP_FAILED) {
+          ::madvise(base, size, MADV_SEQUENTIAL);
+          contents = { static_cast<const char*>(base), size };
+        } else {
+          release();
+        }
+      }
+      ::close(fd);
+    }
+    if (base == MAP_FAILED) {
+      auto file = std::ifstream{path, std::ios::binary};
+      if (!file.good())
+        return;
+      fallback = read_all(file);
+      fallback.append(padding, '\0');
+      contents = std::string_view{fallback}.substr(0, fallback.size() - padding);
+    }
+    ok = true;
+  }
+
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+
+  ~mapped_file() { release(); }
+
+  [[nodiscard]] bool good() const { return ok; }
+  [[nodiscard]] std::string_view view() const { return contents; }
+
+private:
+  void release() {
+    if (base != MAP_FAILED)
+      ::munmap(base, length);
+    base = MAP_FAILED;
+  }
+
+  void* base = MAP_FAILED;
+  size_t length = 0;
+  std::string fallback;
+  std::string_view contents;
+  bool ok = false;
+};
+
+// position of the first "\n\n" at or after `from`, or `npos`
+inline size_t find_blank_line(std::string_view buf, size_t from) {
+#if defined(__SSE2__)
+  auto nl = _mm_set1_epi8('\n');
+  for (; from + 17 <= buf.size(); from += 16) {
+    auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf.data() + from));
+    auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf.data() + from + 1));
+    auto both = _mm_and_si128(_mm_cmpeq_epi8(a, nl), _mm_cmpeq_epi8(b, nl));
+    if (auto mask = static_cast<unsigned>(_mm_movemask_epi8(both)))
+      return from + __builtin_ctz(mask);
+  }
+#endif
+  return buf.find("\n\n", from);
+}
+
+/**
+ * Calls `f` with every non-empty record in `chunk`, without the separating blank lines. Any run of newlines separates
+ * two records, and a chunk may start inside one.
+ */
+template<typename F>
+void for_each(std::string_view chunk, F&& f) {
+  size_t from = 0;
+  while (from < chunk.size()) {
+    from = chunk.find_first_not_of('\n', from);
+    if (from == std::string_view::npos)
+      break;
+    auto to = find_blank_line(chunk, from);
+    auto record = chunk.substr(from, to == std::string_view::npos ? std::string_view::npos : to - from);
+    while (!record.empty() && record.back() == '\n')
+      record.remove_suffix(1);
+    if (!record.empty())
+      f(record);
+    if (to == std::string_view::npos)
+      break;
+    from = to + 2;
+  }
+}
+
+// calls `f` with every line of a record
+template<typename F>
+void for_each_line(std::string_view record, F&& f) {
+  size_t from = 0;
+  while (from <= record.size()) {
+    auto to = std::min(record.find('\n', from), record.size());
+    f(record.substr(from, to - from));
+    from = to + 1;
+  }
+}
+
+/**
+ * Cuts `buf` into at most `n` chunks of about equal size. Every cut is moved forward to just after the next blank line,
+ * so that no record straddles two chunks.
+ */
+inline std::vector<std::string_view> split(std::string_view buf, size_t n) {
+  std::vector<std::string_view> chunks;
+  size_t from = 0;
+  for (size_t i = 1; i <= n && from < buf.size(); i++) {
+    size_t to = buf.size();
+    if (i < n) {
+      auto cut = find_blank_line(buf, std::max(from, buf.size() * i / n));
+      to = cut == std::string_view::npos ? buf.size() : cut + 2;
+    }
+    chunks.push_back(buf.substr(from, to - from));
+    from = to;
+  }
+  return chunks;
+}
+
+/**
+ * Runs `map(chunk) -> Result` on a thread per chunk and folds the results in chunk order with `reduce(acc, result)`.
+ * A chunk is anything `map` takes, a piece of the buffer or a range of parsed entries.
+ */
+template<typename Result, typename Chunk, typename Map, typename Reduce>
+Result map_reduce(std::span<const Chunk> chunks, Map&& map, Reduce&& reduce) {
+  auto partial = std::vector<Result>(chunks.size());
+  {
+    std::vector<std::jthread> threads;
+    for (size_t i = 1; i < chunks.size(); i++)
+      threads.emplace_back([&, i]() { partial[i] = map(chunks[i]); });
+    if (!chunks.empty())
+      partial[0] = map(chunks[0]);
+  }
+
+  auto result = Result {};
+  for (auto& p : partial)
+    reduce(result, p);
+  return result;
+}
+
+/**
+ * `map_reduce` over the records of `buf`, cut by `split` into a chunk per thread. Small inputs aren't worth the
+ * threads and are processed as a single chunk.
+ */
+template<typename Result, typename Map, typename Reduce>
+Result map_reduce(std::string_view buf, Map&& map, Reduce&& reduce,
+                  size_t n_threads = std::thread::hardware_concurrency()) {
+  static constexpr size_t min_chunk = 1 << 20;
+  n_threads = std::clamp<size_t>(n_threads, 1, buf.size() / min_chunk + 1);
+
+  auto chunks = split(buf, n_threads);
+  return map_reduce<Result>(std::span<const std::string_view>(chunks), map, reduce);
+}
+
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "tokenize.hpp"
+
+/**
+ * Blocks until a file is written. The parent directory is watched rather than the file itself, editors tend to save
+ * by writing a temporary file and renaming it over the original.
+ */
+class file_watch {
+public:
+  explicit file_watch(const std::filesystem::path& path)
+      : fd{inotify_init1(IN_CLOEXEC)}, name{path.filename().string()}
+  {
+    if (fd < 0)
+      throw std::runtime_error("inotify_init1 failed");
+    auto dir = path.has_parent_path() ? path.parent_path() : std::filesystem::path{"."};
+    if (inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+      throw std::runtime_error("Couldn't watch " + dir.string());
+  }
+  file_watch(const file_watch&) = delete;
+  file_watch& operator=(const file_watch&) = delete;
+  ~file_watch() { close(fd); }
+
+  void wait() const {
+    alignas(inotify_event) char buf[4096];
+    for (;;) {
+      auto len = read(fd, buf, sizeof buf);
+      if (len <= 0)
+        throw std::runtime_error("inotify read failed");
+      for (auto p = buf; p < buf + len;) {
+        auto ev = reinterpret_cast<const inotify_event*>(p);
+        if (ev->len && name == ev->name)
+          return;
+        p += sizeof(inotify_event) + ev->len;
+      }
+    }
+  }
+
+private:
+  int fd;
+  std::string name;
+};
+
+/**
+ * What a line-oriented solver has to redo after an edit: what is left between the common prefix and the common suffix
+ * of `prev` and `next`. Lines `[from, prev_to)` of `prev` were replaced by lines `[from, next_to)` of `next`, so an
+ * insertion or deletion doesn't shift everything after it into the delta. An append has `from == prev_to ==
+ * prev.size()`.
+ */
+struct line_delta_t {
+  size_t from, prev_to, next_to;
+
+  [[nodiscard]] bool append_only(size_t prev_size) const { return from == prev_size && prev_to == prev_size; }
+};
+
+inline line_delta_t changed_lines(const std::vector<std::string>& prev, const std::vector<std::string>& next) {
+  size_t prefix = 0, suffix = 0;
+  while (prefix < prev.size() && prefix < next.size() && prev[prefix] == next[prefix])
+    prefix++;
+  while (suffix < prev.size() - prefix && suffix < next.size() - prefix
+         && prev[prev.size() - 1 - suffix] == next[next.size() - 1 - suffix])
+    suffix++;
+  return { prefix, prev.size() - suffix, next.size() - suffix };
+}
+
+/**
+ * The loop behind the `--watch` modes: calls `update(prev, next)` with the lines of `path` now and again after every
+ * save, `prev` being the lines of the last successful update. The watch starts before the first read, so a save in
+ * between isn't missed. An exception from `update` is reported and the watch goes on, the next save probably fixes it;
+ * `prev` is empty on the first call and after an error, which tells `update` to start over.
+ */
+template<typename Update>
+[[noreturn]] void watch_lines(const std::filesystem::path& path, Update&& update) {
+  auto watch = file_watch { path };
+  auto prev = std::vector<std::string> {};
+  for (;;) {
+    auto file = std::ifstream { path };
+    auto next = tokenize(file);
+    try {
+      update(std::as_const(prev), std::as_const(next));
+      prev = std::move(next);
+    } catch (const std::exception& e) {
+      std::cerr << "Invalid input: " << e.what() << std::endl;
+      prev.clear();
+    }
+    std::cout.flush();
+    watch.wait();
+  }
+}
@@ -1,67 +1,92 @@
 #include <algorithm>
-#include <numeric>
-#include <set>
+#include <bit>
+#include <cstdint>
+#include <iostream>
+#include <string_view>
 
-#include "day05/arg_input.hpp"
-#include "day05/tokenize.hpp"
+#include "day05/records.hpp"
 
-namespace ranges = std::ranges;
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
-auto main(int argc, char* argv[]) -> int {
-  auto file = get_input(argc, argv);
-
-  if (std::holds_alternative<int>(file))
-    return std::get<int>(file);
-
-  auto& input = std::get<std::ifstream>(file);
+// a bit per question, 'a' in bit 0
+using answers_t = uint32_t;
 
-  auto tokens = tokenize(input);
+constexpr answers_t all_questions = (1u << 26) - 1;
 
-  struct person_t {
-    using answers_t = std::set<char>;
-    answers_t answers;
-  };
-  struct group_t {
-    std::set<char> any_answered;
-    std::set<char> all_answered;
-    std::vector<person_t> persons;
-  };
-  auto groups = std::vector<group_t> {};
+/**
+ * Answers of one person, characters other than 'a'-'z' are ignored. Reads whole 16 byte blocks, so up to 15 bytes
+ * past the line must be readable.
+ * SSE2 can't shift by a different amount per lane, so `1 << n` is built as the float 2^n: the exponent `n + 127` is
+ * shifted into place and converted back to an integer. Ignored bytes get exponent 0, which is the float 0.
+ */
+inline answers_t answers(std::string_view line) {
+#if defined(__SSE2__)
+  const auto index = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  const auto zero = _mm_setzero_si128();
+  auto bits = zero;
+  for (size_t from = 0; from < line.size(); from += 16) {
+    auto c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line.data() + from));
+    auto keep = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('z' + 1)));
+    auto len = static_cast<char>(std::min<size_t>(line.size() - from, 16));
+    keep = _mm_and_si128(keep, _mm_cmplt_epi8(index, _mm_set1_epi8(len)));
+    auto exponent = _mm_and_si128(_mm_add_epi8(c, _mm_set1_epi8(127 - 'a')), keep);
 
-  group_t group {};
-  for (const auto& l : tokens) {
-    if (l.empty()) {
-      groups.push_back(group);
-      group = {};
-      continue;
+    auto lo = _mm_unpacklo_epi8(exponent, zero), hi = _mm_unpackhi_epi8(exponent, zero);
+    for (auto half : {lo, hi}) {
+      for (auto quarter : {_mm_unpacklo_epi16(half, zero), _mm_unpackhi_epi16(half, zero)}) {
+        auto pow2 = _mm_cvttps_epi32(_mm_castsi128_ps(_mm_slli_epi32(quarter, 23)));
+        bits = _mm_or_si128(bits, pow2);
+      }
     }
+  }
+  bits = _mm_or_si128(bits, _mm_shuffle_epi32(bits, _MM_SHUFFLE(1, 0, 3, 2)));
+  bits = _mm_or_si128(bits, _mm_shuffle_epi32(bits, _MM_SHUFFLE(2, 3, 0, 1)));
+  return static_cast<answers_t>(_mm_cvtsi128_si32(bits));
+#else
+  answers_t bits = 0;
+  for (auto c : line)
+    if (c >= 'a' && c <= 'z')
+      bits |= 1u << (c - 'a');
+  return bits;
+#endif
+}
 
-    auto answers = person_t::answers_t {};
-    ranges::copy(l, std::inserter(answers, answers.end()));
-    // union
-    ranges::copy(l, std::inserter(group.any_answered, group.any_answered.end()));
-    // intersection
-    if (group.persons.empty()) {
-      group.all_answered = answers;
-    } else {
-      auto intersect = person_t::answers_t {};
-      std::set_intersection(group.all_answered.cbegin(), group.all_answered.cend(), answers.cbegin(), answers.cend(), std::inserter(intersect, intersect.end()));
-      group.all_answered = intersect;
-    }
-    group.persons.emplace_back(person_t{answers});
+auto main(int argc, char* argv[]) -> int {
+  if (argc < 2) {
+    std::cout << "usage " << argv[0] << " path-to-input" << std::endl;
+    return 0;
   }
-  if (!group.persons.empty())
-    groups.push_back(group);
 
-  auto sum = std::accumulate(groups.cbegin(), groups.cend(), 0, [](auto sum, const auto& group){
-    return sum + group.any_answered.size();
-  });
+  // mapped rather than read, and padded for the block loads in `answers`
+  auto input = records::mapped_file{argv[1]};
+  if (!input.good()) {
+    std::cerr << "Couldn't read " << argv[1] << std::endl;
+    return 1;
+  }
 
-  std::cout << "Part 1: sum is " << sum << "\n";
+  struct sums_t { size_t any = 0, all = 0; };
 
-  auto sum_p2 = std::accumulate(groups.cbegin(), groups.cend(), 0, [](auto sum, const auto& group){
-    return sum + group.all_answered.size();
+  auto sums = records::map_reduce<sums_t>(input.view(), [](std::string_view chunk) {
+    auto sums = sums_t {};
+    records::for_each(chunk, [&sums](std::string_view record) {
+      answers_t any = 0, all = all_questions;
+      records::for_each_line(record, [&](std::string_view l) {
+        auto a = answers(l);
+        any |= a;
+        all &= a;
+      });
+      sums.any += std::popcount(any);
+      sums.all += std::popcount(all);
+    });
+    return sums;
+  }, [](sums_t& acc, const sums_t& s) {
+    acc.any += s.any;
+    acc.all += s.all;
   });
 
-  std::cout << "Part 2: sum is " << sum_p2 << "\n";
-}
\ No newline at end of file
+  std::cout << "Part 1: sum is " << sums.any << "\n";
+
+  std::cout << "Part 2: sum is " << sums.all << "\n";
+}
@@ -0,0 +1,494 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <deque>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Bag rules as a graph over interned colors: an edge `from -> to` with `num` says that a `from` bag directly contains
+ * `num` `to` bags.
+ */
+namespace bags {
+
+using color_t = uint32_t;
+using count_t = uint64_t;
+
+// marks a count that doesn't fit `count_t`
+inline constexpr count_t overflow = UINT64_MAX;
+
+// color names to dense IDs and back
+class interner {
+public:
+  color_t id(std::string_view name) {
+    if (auto it = ids.find(name); it != ids.end())
+      return it->second;
+    auto id = static_cast<color_t>(names.size());
+    ids.emplace(names.emplace_back(name), id);
+    return id;
+  }
+
+  [[nodiscard]] std::optional<color_t> find(std::string_view name) const {
+    if (auto it = ids.find(name); it != ids.end())
+      return it->second;
+    return std::nullopt;
+  }
+
+  [[nodiscard]] const std::string& name(color_t c) const { return names[c]; }
+  [[nodiscard]] size_t size() const { return names.size(); }
+
+private:
+  // a deque doesn't move its strings, so the keys stay valid
+  std::deque<std::string> names;
+  std::unordered_map<std::string_view, color_t> ids;
+};
+
+struct edge_t {
+  color_t from, to;
+  count_t num;
+};
+
+/**
+ * Scans one rule, "{color} bags contain {n} {color} bag(s), ... ." or "{color} bags contain no other bags.", calls
+ * `edge(from, to, num)` for every content and returns the outer color. Colors are interned straight from the line.
+ * Throws `std::invalid_argument` for anything else.
+ */
+template<typename Edge>
+color_t parse_rule(std::string_view line, interner& colors, Edge&& edge) {
+  static constexpr std::string_view contain = " bags contain ", none = "no other bags.", bag = " bag";
+  auto malformed = [&]() { return std::invalid_argument("Malformed rule: " + std::string{line}); };
+
+  auto split = line.find(contain);
+  if (split == std::string_view::npos)
+    throw malformed();
+  auto outer = colors.id(line.substr(0, split));
+  auto rest = line.substr(split + contain.size());
+  if (rest == none)
+    return outer;
+
+  while (true) {
+    count_t num = 0;
+    auto [p, ec] = std::from_chars(rest.data(), rest.data() + rest.size(), num);
+    auto at = static_cast<size_t>(p - rest.data());
+    if (ec != std::errc{} || at >= rest.size() || rest[at] != ' ')
+      throw malformed();
+    rest.remove_prefix(at + 1);
+
+    auto end = rest.find(bag);
+    if (end == std::string_view::npos || end == 0)
+      throw malformed();
+    edge(outer, colors.id(rest.substr(0, end)), num);
+    rest.remove_prefix(end + bag.size());
+    if (!rest.empty() && rest.front() == 's')
+      rest.remove_prefix(1);
+
+    if (rest == ".")
+      return outer;
+    if (!rest.starts_with(", "))
+      throw malformed();
+    rest.remove_prefix(2);
+  }
+}
+
+// every non-empty line of `rules` as edges
+inline std::vector<edge_t> parse_rules(std::string_view rules, interner& colors) {
+  auto edges = std::vector<edge_t> {};
+  for (size_t from = 0; from < rules.size();) {
+    auto to = std::min(rules.find('\n', from), rules.size());
+    auto line = rules.substr(from, to - from);
+    if (!line.empty() && line.back() == '\r')
+      line.remove_suffix(1);
+    if (!line.empty())
+      parse_rule(line, colors, [&](color_t from, color_t to, count_t num) { edges.push_back({from, to, num}); });
+    from = to + 1;
+  }
+  return edges;
+}
+
+/**
+ * Forward and reverse adjacency in compressed sparse row form: the edges out of `c` are `[out_offset[c],
+ * out_offset[c+1])` of `out_to`/`out_num`, the colors directly containing `c` are `[in_offset[c], in_offset[c+1])` of
+ * `in_from`.
+ */
+struct graph_t {
+  std::vector<uint32_t> out_offset, in_offset;
+  std::vector<color_t> out_to, in_from;
+  std::vector<count_t> out_num;
+
+  graph_t() : graph_t(0, {}) {}
+
+  graph_t(size_t n_colors, std::span<const edge_t> edges)
+      : out_offset(n_colors + 1), in_offset(n_colors + 1),
+        out_to(edges.size()), in_from(edges.size()), out_num(edges.size()) {
+    for (const auto& e : edges) {
+      out_offset[e.from + 1]++;
+      in_offset[e.to + 1]++;
+    }
+    for (size_t c = 0; c < n_colors; c++) {
+      out_offset[c + 1] += out_offset[c];
+      in_offset[c + 1] += in_offset[c];
+    }
+    auto out_next = std::vector<uint32_t>(out_offset.begin(), out_offset.end() - 1);
+    auto in_next = std::vector<uint32_t>(in_offset.begin(), in_offset.end() - 1);
+    for (const auto& e : edges) {
+      auto o = out_next[e.from]++;
+      out_to[o] = e.to;
+      out_num[o] = e.num;
+      in_from[in_next[e.to]++] = e.from;
+    }
+  }
+
+  [[nodiscard]] size_t size() const { return out_offset.size() - 1; }
+
+  [[nodiscard]] std::span<const color_t> contains(color_t c) const {
+    return { out_to.data() + out_offset[c], out_to.data() + out_offset[c + 1] };
+  }
+  [[nodiscard]] std::span<const count_t> contains_num(color_t c) const {
+    return { out_num.data() + out_offset[c], out_num.data() + out_offset[c + 1] };
+  }
+  [[nodiscard]] std::span<const color_t> contained_by(color_t c) const {
+    return { in_from.data() + in_offset[c], in_from.data() + in_offset[c + 1] };
+  }
+};
+
+// colors that eventually contain a `target` bag, nearest first: a breadth-first search over the reverse edges
+inline std::vector<color_t> containers_of(const graph_t& g, color_t target) {
+  auto seen = std::vector<bool>(g.size());
+  auto queue = std::vector<color_t> {target};
+  seen[target] = true;
+  for (size_t head = 0; head < queue.size(); head++)
+    for (auto c : g.contained_by(queue[head]))
+      if (!seen[c]) {
+        seen[c] = true;
+        queue.push_back(c);
+      }
+  queue.erase(queue.begin());
+  return queue;
+}
+
+inline size_t count_containers(const graph_t& g, color_t target) {
+  return containers_of(g, target).size();
+}
+
+/**
+ * The colors ordered so that every color comes after all colors it contains.
+ * Throws `std::invalid_argument` if the rules have a cycle.
+ */
+inline std::vector<color_t> contents_first(const graph_t& g) {
+  auto pending = std::vector<uint32_t>(g.size());
+  auto order = std::vector<color_t> {};
+  order.reserve(g.size());
+  for (color_t c = 0; c < g.size(); c++) {
+    pending[c] = static_cast<uint32_t>(g.contains(c).size());
+    if (!pending[c])
+      order.push_back(c);
+  }
+  for (size_t head = 0; head < order.size(); head++)
+    for (auto parent : g.contained_by(order[head]))
+      if (--pending[parent] == 0)
+        order.push_back(parent);
+
+  if (order.size() != g.size())
+    throw std::invalid_argument("Rules contain a cycle");
+  return order;
+}
+
+// number of bags inside one bag of every color, `overflow` for those that don't fit; every count is computed once
+inline std::vector<count_t> inner_counts(const graph_t& g, std::span<const color_t> order) {
+  auto inner = std::vector<count_t>(g.size());
+  for (auto c : order) {
+    auto to = g.contains(c);
+    auto num = g.contains_num(c);
+    count_t sum = 0;
+    for (size_t i = 0; i < to.size() && sum != overflow; i++) {
+      count_t bags;
+      if (__builtin_add_overflow(inner[to[i]], 1, &bags) || __builtin_mul_overflow(bags, num[i], &bags)
+          || __builtin_add_overflow(sum, bags, &sum) || sum == overflow)
+        sum = overflow;
+    }
+    inner[c] = sum;
+  }
+  return inner;
+}
+
+inline std::vector<count_t> inner_counts(const graph_t& g) {
+  return inner_counts(g, contents_first(g));
+}
+
+/**
+ * Number of colors that eventually contain each color. The ancestor sets are bitsets propagated down from the
+ * outermost colors, which for all colors at once would take n^2 bits. Instead the ancestors are taken a block of
+ * colors at a time, with the block sized so that the bitsets of all colors fit in `max_bytes`, and every block adds
+ * the popcounts of its bitsets. The total work stays O(n (n + edges) / 64).
+ */
+inline std::vector<count_t> container_counts(const graph_t& g, std::span<const color_t> order,
+                                             size_t max_bytes = size_t{1} << 26) {
+  const auto n = g.size();
+  auto counts = std::vector<count_t>(n);
+  if (n == 0)
+    return counts;
+  const auto words = std::clamp<size_t>(max_bytes / (n * sizeof(uint64_t)), 1, (n + 63) / 64);
+  auto bits = std::vector<uint64_t>(n * words);
+
+  for (size_t block = 0; block < n; block += 64 * words) {
+    std::fill(bits.begin(), bits.end(), 0);
+    // outermost colors first, so the parents' ancestors are complete
+    for (auto it = order.rbegin(); it != order.rend(); it++) {
+      auto c = *it;
+      auto row = bits.data() + c * words;
+      for (auto p : g.contained_by(c)) {
+        auto parent = bits.data() + p * words;
+        for (size_t w = 0; w < words; w++)
+          row[w] |= parent[w];
+        if (p >= block && p - block < 64 * words)
+          row[(p - block) / 64] |= uint64_t{1} << ((p - block) % 64);
+      }
+      for (size_t w = 0; w < words; w++)
+        counts[c] += std::popcount(row[w]);
+    }
+  }
+  return counts;
+}
+
+/**
+ * Rules that change over time, with both answers for one target color kept up to date.
+ * Which colors eventually contain the target is maintained eagerly: a new rule can only add containers above its
+ * color, a replaced or removed one can only lose containers among the colors above it, and only those are rechecked.
+ * Inner counts are memoized and computed on demand; a changed rule drops the memo of its color and of everything
+ * above it, up to colors that were already dropped (everything above a dropped color is dropped too).
+ */
+class dynamic_graph {
+public:
+  explicit dynamic_graph(std::string_view target) : target{colors.id(target)} {
+    grow();
+  }
+
+  // sets (adds or replaces) the rule of the line's outer color, throws `std::invalid_argument` for a malformed rule
+  void set_rule(std::string_view line) {
+    auto contents = std::vector<std::pair<color_t, count_t>> {};
+    color_t outer;
+    try {
+      outer = parse_rule(line, colors, [&](color_t, color_t to, count_t num) { contents.emplace_back(to, num); });
+    } catch (const std::invalid_argument&) {
+      // colors interned before the error still need their slots, a later event may name them
+      grow();
+      throw;
+    }
+    grow();
+    replace(outer, std::move(contents));
+  }
+
+  // the color no longer contains anything, it may still be inside others
+  void remove_rule(std::string_view color) {
+    if (auto c = colors.find(color))
+      replace(*c, {});
+  }
+
+  [[nodiscard]] size_t containers() const { return n_containers; }
+
+  // bags inside the target, `overflow` if they don't fit and nullopt if the rules have a cycle below it
+  std::optional<count_t> inner() {
+    if (state[target] == valid)
+      return memo[target];
+
+    auto stack = std::vector<std::pair<color_t, size_t>> {{target, 0}};
+    state[target] = visiting;
+    while (!stack.empty()) {
+      auto& [c, i] = stack.back();
+      if (i < contents[c].size()) {
+        auto to = contents[c][i++].first;
+        if (state[to] == visiting) {
+          for (auto [s, _] : stack)
+            state[s] = dropped;
+          return std::nullopt;
+        }
+        if (state[to] == dropped) {
+          state[to] = visiting;
+          stack.emplace_back(to, 0);
+        }
+        continue;
+      }
+      count_t sum = 0;
+      for (auto [to, num] : contents[c]) {
+        count_t bags;
+        if (sum == overflow || __builtin_add_overflow(memo[to], 1, &bags) || __builtin_mul_overflow(bags, num, &bags)
+            || __builtin_add_overflow(sum, bags, &sum) || sum == overflow)
+          sum = overflow;
+      }
+      memo[c] = sum;
+      state[c] = valid;
+      stack.pop_back();
+    }
+    return memo[target];
+  }
+
+private:
+  enum state_e : uint8_t { dropped, visiting, valid };
+
+  void grow() {
+    auto n = colors.size();
+    contents.resize(n);
+    parents.resize(n);
+    reaches.resize(n);
+    memo.resize(n);
+    state.resize(n, dropped);
+  }
+
+  void replace(color_t c, std::vector<std::pair<color_t, count_t>> next) {
+    for (auto [to, _] : contents[c]) {
+      auto& p = parents[to];
+      p.erase(std::find(p.begin(), p.end(), c));
+    }
+    contents[c] = std::move(next);
+    for (auto [to, _] : contents[c])
+      parents[to].push_back(c);
+
+    drop(c);
+    recheck(c);
+  }
+
+  void drop(color_t c) {
+    auto stack = std::vector<color_t> {c};
+    while (!stack.empty()) {
+      auto d = stack.back();
+      stack.pop_back();
+      if (state[d] == dropped)
+        continue;
+      state[d] = dropped;
+      stack.insert(stack.end(), parents[d].begin(), parents[d].end());
+    }
+  }
+
+  /**
+   * The colors whose answer may have changed are `c` and, if it contained the target, the containers above it. They
+   * are unmarked, then every one of them with a content that still reaches the target is marked again together with
+   * everything above it.
+   */
+  void recheck(color_t c) {
+    auto affected = std::vector<color_t> {c};
+    if (reaches[c]) {
+      reaches[c] = false;
+      for (size_t head = 0; head < affected.size(); head++)
+        for (auto p : parents[affected[head]])
+          if (reaches[p]) {
+            reaches[p] = false;
+            affected.push_back(p);
+          }
+      n_containers -= affected.size();
+    }
+
+    for (auto a : affected) {
+      if (reaches[a])
+        continue;
+      auto direct = std::any_of(contents[a].begin(), contents[a].end(), [&](const auto& content) {
+        return content.first == target || reaches[content.first];
+      });
+      if (direct)
+        mark(a);
+    }
+  }
+
+  void mark(color_t c) {
+    auto stack = std::vector<color_t> {c};
+    while (!stack.empty()) {
+      auto m = stack.back();
+      stack.pop_back();
+      if (reaches[m] || m == target)
+        continue;
+      reaches[m] = true;
+      n_containers++;
+      stack.insert(stack.end(), parents[m].begin(), parents[m].end());
+    }
+  }
+
+  interner colors;
+  color_t target;
+  std::vector<std::vector<std::pair<color_t, count_t>>> contents;
+  std::vector<std::vector<color_t>> parents;
+  std::vector<bool> reaches;
+  size_t n_containers = 0;
+  std::vector<count_t> memo;
+  std::vector<state_e> state;
+};
+
+/**
+ * Both answers for every color, so that a count is a name lookup, and the rules themselves, so that the containers of a
+ * color can be listed. Written after a header line as one line per color, "{containers} {inner} {name}", then an empty
+ * line and one line per rule content, "{from} {to} {num}" with the colors as their line numbers (from 0) above.
+ */
+struct index_t {
+  static constexpr std::string_view header = "bag-index 2";
+
+  interner colors;
+  graph_t graph;
+  std::vector<count_t> containers, inner;
+
+  index_t(interner colors, graph_t g) : colors{std::move(colors)}, graph{std::move(g)} {
+    auto order = contents_first(graph);
+    containers = container_counts(graph, order);
+    inner = inner_counts(graph, order);
+  }
+
+  explicit index_t(std::istream& is) {
+    std::string line;
+    if (!std::getline(is, line) || line != header)
+      throw std::invalid_argument("Not a bag index");
+
+    // reads the numbers at the start of `line`, each followed by a space unless it ends the line
+    auto numbers = [&](std::span<count_t> out, bool last_ends) {
+      const char *p = line.data(), *end = line.data() + line.size();
+      for (size_t i = 0; i < out.size(); i++) {
+        auto [next, ec] = std::from_chars(p, end, out[i]);
+        auto ends = last_ends && i + 1 == out.size();
+        if (ec != std::errc{} || (ends ? next != end : next == end || *next != ' '))
+          throw std::invalid_argument("Malformed bag index line: " + line);
+        p = next + 1;
+      }
+      return std::string_view{std::min(p, end), end};
+    };
+
+    while (std::getline(is, line) && !line.empty()) {
+      count_t counts[2];
+      auto name = numbers(counts, false);
+      if (colors.id(name) != containers.size())
+        throw std::invalid_argument("Duplicate color in bag index: " + line);
+      containers.push_back(counts[0]);
+      inner.push_back(counts[1]);
+    }
+
+    auto edges = std::vector<edge_t> {};
+    while (std::getline(is, line)) {
+      count_t edge[3];
+      numbers(edge, true);
+      if (edge[0] >= colors.size() || edge[1] >= colors.size())
+        throw std::invalid_argument("Unknown color in bag index: " + line);
+      edges.push_back({static_cast<color_t>(edge[0]), static_cast<color_t>(edge[1]), edge[2]});
+    }
+    graph = graph_t { colors.size(), edges };
+  }
+
+  void save(std::ostream& os) const {
+    os << header << "\n";
+    for (color_t c = 0; c < colors.size(); c++)
+      os << containers[c] << " " << inner[c] << " " << colors.name(c) << "\n";
+    os << "\n";
+    for (color_t c = 0; c < graph.size(); c++) {
+      auto to = graph.contains(c);
+      auto num = graph.contains_num(c);
+      for (size_t i = 0; i < to.size(); i++)
+        os << c << " " << to[i] << " " << num[i] << "\n";
+    }
+  }
+};
+
+}
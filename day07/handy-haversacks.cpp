@@ -1,81 +1,225 @@
 #include <algorithm>
-#include <regex>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
 #include <string_view>
-#include <set>
-#include <numeric>
+#include <vector>
 
+#include "bags.hpp"
 #include "day05/arg_input.hpp"
-#include "day05/tokenize.hpp"
 
-namespace ranges = std::ranges;
+/**
+ * One "containers {color}", "inner {color}" or "which {color}" per line, answered in order. "which" lists the colors
+ * that eventually contain the color, by name.
+ */
+void answer(const bags::index_t& index, std::istream& queries, std::ostream& os) {
+  for (std::string line; std::getline(queries, line);) {
+    if (line.empty())
+      continue;
+    auto ws = line.find(' ');
+    auto kind = std::string_view{line}.substr(0, ws);
+    auto color = ws == std::string::npos ? std::nullopt : index.colors.find(std::string_view{line}.substr(ws + 1));
+    os << line << ": ";
+    if ((kind != "containers" && kind != "inner" && kind != "which") || !color) {
+      os << (color ? "unknown query" : "unknown color") << "\n";
+      continue;
+    }
+    if (kind == "which") {
+      auto names = std::vector<std::string_view> {};
+      for (auto c : bags::containers_of(index.graph, *color))
+        names.emplace_back(index.colors.name(c));
+      std::sort(names.begin(), names.end());
+      for (size_t i = 0; i < names.size(); i++)
+        os << (i ? ", " : "") << names[i];
+      os << "\n";
+      continue;
+    }
+    auto count = kind == "containers" ? index.containers[*color] : index.inner[*color];
+    if (count == bags::overflow)
+      os << "too many bags\n";
+    else
+      os << count << "\n";
+  }
+}
+
+void report(bags::dynamic_graph& graph, size_t events) {
+  auto inner = graph.inner();
+  std::cout << "after " << events << " events: " << graph.containers() << " colors, ";
+  if (!inner)
+    std::cout << "rules contain a cycle\n";
+  else if (*inner == bags::overflow)
+    std::cout << "too many bags\n";
+  else
+    std::cout << *inner << " bags\n";
+  std::cout.flush();
+}
 
-auto resolve (const std::string& color, const auto& rules) -> size_t {
-  auto contains = rules.at(color).contains;
-  return std::accumulate(contains.cbegin(), contains.cend(), 1, [&](size_t num, const auto& r){
-    return num + r.num * resolve(r.color, rules);
-  });
-};
+/**
+ * Applies "add {rule}", "update {rule}" or "remove {color}" events, one per line, and reports the shiny gold answers
+ * after every batch. Batches end at an empty line and at the end of the events. A malformed rule in an event is
+ * reported and skipped, one in the initial rules ends the run.
+ */
+int follow(std::string_view rules, std::istream& events) {
+  auto graph = bags::dynamic_graph {"shiny gold"};
+  for (size_t from = 0; from < rules.size();) {
+    auto to = std::min(rules.find('\n', from), rules.size());
+    try {
+      if (to > from)
+        graph.set_rule(rules.substr(from, to - from));
+    } catch (const std::invalid_argument& e) {
+      std::cerr << e.what() << std::endl;
+      return 1;
+    }
+    from = to + 1;
+  }
+  report(graph, 0);
+
+  size_t applied = 0, pending = 0;
+  for (std::string line; std::getline(events, line);) {
+    if (line.empty()) {
+      if (pending)
+        report(graph, applied);
+      pending = 0;
+      continue;
+    }
+    auto ws = line.find(' ');
+    auto kind = std::string_view{line}.substr(0, ws);
+    auto arg = std::string_view{line}.substr(ws == std::string::npos ? line.size() : ws + 1);
+    if (kind == "add" || kind == "update") {
+      try {
+        graph.set_rule(arg);
+      } catch (const std::invalid_argument& e) {
+        std::cerr << "Skipped event " << line << ": " << e.what() << std::endl;
+        continue;
+      }
+    } else if (kind == "remove") {
+      graph.remove_rule(arg);
+    } else {
+      std::cerr << "Unknown event " << line << std::endl;
+      return 1;
+    }
+    applied++;
+    pending++;
+  }
+  if (pending)
+    report(graph, applied);
+  return 0;
+}
 
 auto main(int argc, char* argv[]) -> int {
+  auto is_index = false, usage = argc < 2;
+  const char* queries = nullptr;
+  const char* save = nullptr;
+  const char* events = nullptr;
+  for (int i = 2; i < argc; i++) {
+    auto arg = std::string_view{argv[i]};
+    if (arg == "--index")
+      is_index = true;
+    else if (arg == "--queries" && i + 1 < argc)
+      queries = argv[++i];
+    else if (arg == "--save" && i + 1 < argc)
+      save = argv[++i];
+    else if (arg == "--events" && i + 1 < argc)
+      events = argv[++i];
+    else
+      usage = true;
+  }
+  if (usage || (is_index && !queries && !save) || (events && (is_index || queries || save))) {
+    std::cout << "usage " << argv[0] << " path-to-input [--index] [--queries path-to-queries|-] [--save path-to-index]" << std::endl;
+    std::cout << "      " << argv[0] << " path-to-input --events path-to-events|-" << std::endl;
+    return 0;
+  }
+
   auto file = get_input(argc, argv);
   if (std::holds_alternative<int>(file))
     return std::get<int>(file);
 
   auto& input = std::get<std::ifstream>(file);
 
-  auto tokens = tokenize(input);
-
-  struct rule_t {
-    struct spec_t { size_t num; std::string color; };
-    std::string bag;
-    std::vector<spec_t> contains;
-  };
-
-  using rules_t = std::unordered_map<std::string, rule_t>;
-  rules_t rules (tokens.size());
-
-  ranges::transform(tokens, std::inserter(rules, rules.end()), [](const auto& s) -> rules_t::value_type {
-    auto rule = rule_t {};
-    std::smatch match;
-    std::regex_match(s, match, std::regex(R"((\w+\ \w+) bags contain (no other bags|.+).)"));
-    rule.bag = match[1];
-    if (match[2] != "no other bags") {
-      std::string contains = match[2];
-      auto from = 0, to = 0;
-      std::vector<std::string> tokens;
-      static const auto delim = std::string_view {", "};
-      while ((to = contains.find(delim, from)) != std::string::npos) {
-        tokens.push_back(contains.substr(from, to-from));
-        from = to + delim.size();
+  auto index = std::optional<bags::index_t> {};
+  if (is_index) {
+    try {
+      index.emplace(input);
+    } catch (const std::invalid_argument& e) {
+      std::cerr << e.what() << std::endl;
+      return 1;
+    }
+  } else {
+    auto colors = bags::interner {};
+    auto rules = std::string { std::istreambuf_iterator<char>{input}, std::istreambuf_iterator<char>{} };
+
+    if (events) {
+      if (std::string_view{events} == "-")
+        return follow(rules, std::cin);
+      auto event_file = std::ifstream{events};
+      if (!event_file.good()) {
+        std::cerr << "Couldn't read " << events << std::endl;
+        return 1;
       }
-      tokens.push_back(contains.substr(from, contains.find('.') - from));
-      rule.contains.resize(tokens.size());
-      ranges::transform(tokens, rule.contains.begin(), [](const auto& r) -> rule_t::spec_t {
-        auto ws = r.find(' ');
-        size_t num = std::stoi(r.substr(0, ws));
-        auto ws2 = r.find(' ', ws+1);
-        ws2 = r.find(' ', ws2+1);
-        return { num, r.substr(ws+1, ws2-ws-1) };
-      });
+      return follow(rules, event_file);
+    }
+
+    auto edges = std::vector<bags::edge_t> {};
+    try {
+      edges = bags::parse_rules(rules, colors);
+    } catch (const std::invalid_argument& e) {
+      std::cerr << e.what() << std::endl;
+      return 1;
     }
-    return {rule.bag, rule};
-  });
-
-  std::set<std::string> containers {"shiny gold"};
-  bool grew = true;
-  while (grew) {
-    auto s = containers.size();
-    for (const auto& rule : rules) {
-      if (ranges::find_if(rule.second.contains, [&](const rule_t::spec_t& s){
-        return containers.find(s.color) != containers.cend();
-      }) != rule.second.contains.cend()) {
-        containers.insert(rule.first);
+    auto graph = bags::graph_t { colors.size(), edges };
+
+    if (queries || save) {
+      try {
+        index.emplace(std::move(colors), std::move(graph));
+      } catch (const std::invalid_argument& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+      }
+    } else {
+      auto shiny_gold = colors.find("shiny gold");
+      if (!shiny_gold) {
+        std::cerr << "No rule mentions shiny gold bags" << std::endl;
+        return 1;
+      }
+
+      std::cout << "Part 1: " << bags::count_containers(graph, *shiny_gold) << " colors\n";
+
+      auto inner = bags::count_t {};
+      try {
+        inner = bags::inner_counts(graph)[*shiny_gold];
+      } catch (const std::invalid_argument& e) {
+        std::cerr << "Part 2: " << e.what() << std::endl;
+        return 1;
+      }
+      if (inner == bags::overflow) {
+        std::cerr << "Part 2: too many bags to count" << std::endl;
+        return 1;
       }
+      std::cout << "Part 2: " << inner << " bags\n";
+      return 0;
     }
-    grew = containers.size() > s;
   }
 
-  std::cout << "Part 1: " << containers.size()-1 << " colors\n";
+  if (save) {
+    auto out = std::ofstream{save};
+    index->save(out);
+    if (!out.good()) {
+      std::cerr << "Couldn't write " << save << std::endl;
+      return 1;
+    }
+  }
 
-  std::cout << "Part 2: " << resolve("shiny gold", rules)-1 << " bags\n";
-}
\ No newline at end of file
+  if (queries) {
+    if (std::string_view{queries} == "-") {
+      answer(*index, std::cin, std::cout);
+    } else {
+      auto query_file = std::ifstream{queries};
+      if (!query_file.good()) {
+        std::cerr << "Couldn't read " << queries << std::endl;
+        return 1;
+      }
+      answer(*index, query_file, std::cout);
+    }
+  }
+}
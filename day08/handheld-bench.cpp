@@ -0,0 +1,65 @@
+#include "handheld.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+
+/**
+ * Compares `execute` with `threaded_t` on generated programs: mostly `acc` and `nop` with short forward jumps, and a
+ * jump back to the start at the end, so that both engines run through the whole program before they detect the loop.
+ */
+handheld::program_t generate(size_t size, std::mt19937& rng) {
+  using namespace handheld;
+  auto program = program_t(size);
+  auto kind = std::uniform_int_distribution<int>(0, 9);
+  auto val = std::uniform_int_distribution<int>(-50, 50);
+  auto skip = std::uniform_int_distribution<int>(1, 3);
+  for (auto& instr : program) {
+    auto k = kind(rng);
+    instr = k < 5 ? instr_t{ins_e::acc, val(rng)} : k < 8 ? instr_t{ins_e::nop, val(rng)} : instr_t{ins_e::jmp, skip(rng)};
+  }
+  // nothing jumps past the final jump back
+  for (size_t i = size > 4 ? size - 4 : 0; i < size; i++)
+    program[i] = { ins_e::nop, 0 };
+  program.back() = { ins_e::jmp, -static_cast<int>(size - 1) };
+  return program;
+}
+
+template<typename F>
+double time_ms(size_t runs, F&& f) {
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < runs; i++)
+    f();
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / runs;
+}
+
+auto main(int argc, char* argv[]) -> int {
+  using namespace handheld;
+
+  auto size = argc > 1 ? std::stoull(argv[1]) : 1'000'000;
+  auto runs = argc > 2 ? std::stoull(argv[2]) : 10;
+  if (size < 1 || runs < 1) {
+    std::cout << "usage " << argv[0] << " [instructions] [runs]" << std::endl;
+    return 0;
+  }
+
+  auto rng = std::mt19937 {2020};
+  auto program = generate(size, rng);
+
+  auto expected = execute(program);
+  auto engine = threaded_t { program };
+  auto actual = engine.execute();
+  if (actual.exit != expected.exit || actual.pc != expected.pc || actual.r0 != expected.r0) {
+    std::cerr << "engines disagree: " << expected << " vs " << actual << std::endl;
+    return 1;
+  }
+
+  auto decode = time_ms(runs, [&]() { threaded_t { program }; });
+  auto switched = time_ms(runs, [&]() { execute(program); });
+  auto threaded = time_ms(runs, [&]() { engine.execute(); });
+
+  std::cout << size << " instructions, " << expected << "\n";
+  std::cout << "switch:   " << switched << " ms/run\n";
+  std::cout << "threaded: " << threaded << " ms/run (+ " << decode << " ms to decode once)\n";
+}
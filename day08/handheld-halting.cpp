@@ -15,18 +15,14 @@ auto main(int argc, char* argv[]) -> int {
 
   auto program = read_program(tokenize(input));
 
-  std::cout << "Part 1: " << execute(program) << "\n";
-
-  using from_to_t = std::pair<ins_e, ins_e>;
-  for (const auto& [from, to] : { from_to_t{ins_e::jmp, ins_e::nop}, {ins_e::nop, ins_e::jmp} }) {
-    for (size_t i = 0; i < program.size(); i++) {
-      auto copy = program;
-      if (copy[i].ins == from) {
-        copy[i].ins = to;
-        auto machine = execute(copy);
-        if (machine.exit == machine_t::exit_e::normal)
-          std::cout << "Part 2: Changed instruction " << i << " " << ins_str(from) << " to " << ins_str(to) << "; " << machine << "\n";
-      }
-    }
+  // `--threaded` runs part 1 on the pre-decoded engine, `--search` finds the repair by trying every flip
+  auto threaded = false, search = false;
+  for (int i = 2; i < argc; i++) {
+    threaded |= std::string_view{argv[i]} == "--threaded";
+    search |= std::string_view{argv[i]} == "--search";
   }
-}
\ No newline at end of file
+  std::cout << "Part 1: " << (threaded ? threaded_t{program}.execute() : execute(program)) << "\n";
+
+  if (auto fix = search ? search_repair(program) : repair(program))
+    std::cout << "Part 2: Changed instruction " << fix->pc << " " << ins_str(fix->from) << " to " << ins_str(fix->to) << "; " << fix->machine << "\n";
+}
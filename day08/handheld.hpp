@@ -1,9 +1,15 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <optional>
 #include <ranges>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include <ostream>
 
@@ -55,8 +61,18 @@ struct machine_t {
   int r0 = 0;
 };
 
-machine_t execute(const program_t &program, machine_t m = {}) {
-  auto visited = std::vector<bool>(program.size());
+// "instruction `pc` is treated as `ins`", applied on the fly so the program isn't copied
+struct patch_t {
+  size_t pc;
+  ins_e ins;
+};
+
+// runs with a caller's `visited` buffer, which is cleared first so it can be reused between runs
+machine_t execute(const program_t &program, std::vector<bool>& visited, std::optional<patch_t> patch = {},
+                  machine_t m = {}) {
+  visited.assign(program.size(), false);
+  // signed like `m.pc`, -1 is never reached
+  const auto patch_pc = patch ? static_cast<int>(patch->pc) : -1;
 
   for (;;) {
     if (m.pc >= program.size()) {
@@ -72,6 +88,8 @@ machine_t execute(const program_t &program, machine_t m = {}) {
     visited[m.pc] = true;
 
     auto instr = program[m.pc];
+    if (m.pc == patch_pc)
+      instr.ins = patch->ins;
 
     switch (instr.ins) {
       case ins_e::nop:break;
@@ -86,6 +104,224 @@ machine_t execute(const program_t &program, machine_t m = {}) {
   return m;
 };
 
+machine_t execute(const program_t &program, machine_t m = {}) {
+  auto visited = std::vector<bool>(program.size());
+  return execute(program, visited, {}, m);
+}
+
+/**
+ * The same machine as `execute` from pc 0, for running a program many times. The program is decoded once into
+ * direct-threaded superinstructions: the entry of every pc holds the address of its handler (GCC's labels as values),
+ * the sum of the `acc`s up to the end of its straight-line run and where the run continues. Each handler jumps straight
+ * to the next entry's handler instead of returning to a `switch`.
+ * A run only ends at a `jmp` or before a jump target, and a pc can only be reached a second time through one of those
+ * (or its predecessor would have been reached a second time first), so checking for loops at run boundaries stops at
+ * the same pc with the same accumulator as `execute`. The loop-detection bitmap is kept between runs.
+ */
+class threaded_t {
+public:
+  explicit threaded_t(const program_t& program) : code(program.size()), seen(program.size() / 64 + 1) {
+    const auto n = static_cast<int64_t>(program.size());
+    auto target = std::vector<bool>(n + 1);
+    for (int64_t pc = 0; pc < n; pc++)
+      if (program[pc].ins == ins_e::jmp) {
+        if (auto to = pc + program[pc].val; to >= 0 && to < n)
+          target[to] = true;
+        target[pc + 1] = true;
+      }
+
+    auto handlers = handler_table();
+    for (auto pc = n - 1; pc >= 0; pc--) {
+      const auto& instr = program[pc];
+      auto next = instr.ins == ins_e::jmp ? pc + instr.val : pc + 1;
+      uint32_t sum = instr.ins == ins_e::acc ? instr.val : 0;
+      if (next < 0 || next >= n)
+        code[pc] = { handlers[op_leave], sum, static_cast<int32_t>(next) };
+      else if (instr.ins == ins_e::jmp || target[next])
+        code[pc] = { handlers[op_go], sum, static_cast<int32_t>(next) };
+      else
+        code[pc] = { code[next].handler, sum + code[next].sum, code[next].next };
+    }
+  }
+
+  machine_t execute() {
+    if (code.empty())
+      return { machine_t::exit_e::normal };
+    std::fill(seen.begin(), seen.end(), 0);
+    return run(code.data(), seen.data());
+  }
+
+private:
+  enum op_e { op_go, op_leave, n_ops };
+
+  // the accumulator wraps like `execute`'s int
+  struct op_t {
+    const void* handler;
+    uint32_t sum;
+    int32_t next;
+  };
+
+  // labels only have addresses inside their function, `run` hands them out when it gets a `table` to fill
+  static const void* const* handler_table() {
+    const void* const* table = nullptr;
+    run(nullptr, nullptr, &table);
+    return table;
+  }
+
+  static machine_t run(const op_t* code, uint64_t* seen, const void* const** table = nullptr) {
+    static const void* const handlers[n_ops] = { &&go, &&leave };
+    if (table) {
+      *table = handlers;
+      return {};
+    }
+
+    int64_t pc = 0;
+    uint32_t r0 = 0;
+    seen[0] = 1;
+    goto *code[pc].handler;
+
+  go:
+    r0 += code[pc].sum;
+    pc = code[pc].next;
+    if (seen[pc / 64] >> (pc % 64) & 1u)
+      return { machine_t::exit_e::loop, static_cast<int>(pc), static_cast<int>(r0) };
+    seen[pc / 64] |= uint64_t{1} << (pc % 64);
+    // runs mostly go forward, fetch ahead of them (a prefetch never faults)
+    __builtin_prefetch(code + pc + 32);
+    goto *code[pc].handler;
+
+  leave:
+    r0 += code[pc].sum;
+    pc = code[pc].next;
+    return { machine_t::exit_e::normal, static_cast<int>(pc), static_cast<int>(r0) };
+  }
+
+  std::vector<op_t> code;
+  std::vector<uint64_t> seen;
+};
+
+// where execution continues after `program[pc]`, anything outside the program ends it
+inline int64_t next_pc(const instr_t& instr, int64_t pc) {
+  return instr.ins == ins_e::jmp ? pc + instr.val : pc + 1;
+}
+
+struct repair_t {
+  size_t pc;
+  ins_e from, to;
+  machine_t machine;
+};
+
+/**
+ * Finds the single `jmp`/`nop` flip that makes a looping program exit normally, and how the repaired program ends.
+ * The predecessors of every instruction are collected once and searched backwards from the instructions that leave
+ * the program, which marks every pc that terminates unchanged. A flip can only matter on the original path, so that
+ * path is walked once and the first instruction whose flipped successor terminates is the repair. Everything is linear
+ * in the size of the program. Returns nullopt if the program doesn't loop or no single flip helps.
+ */
+std::optional<repair_t> repair(const program_t& program) {
+  const auto n = static_cast<int64_t>(program.size());
+  auto inside = [n](int64_t pc) { return pc >= 0 && pc < n; };
+
+  // predecessors in compressed sparse row form
+  auto offset = std::vector<uint32_t>(n + 1);
+  for (int64_t pc = 0; pc < n; pc++)
+    if (auto next = next_pc(program[pc], pc); inside(next))
+      offset[next + 1]++;
+  for (int64_t pc = 0; pc < n; pc++)
+    offset[pc + 1] += offset[pc];
+  auto preds = std::vector<uint32_t>(offset[n]);
+  auto fill = std::vector<uint32_t>(offset.begin(), offset.end() - 1);
+  for (int64_t pc = 0; pc < n; pc++)
+    if (auto next = next_pc(program[pc], pc); inside(next))
+      preds[fill[next]++] = static_cast<uint32_t>(pc);
+
+  auto terminates = std::vector<bool>(n);
+  auto queue = std::vector<uint32_t> {};
+  for (int64_t pc = 0; pc < n; pc++)
+    if (!inside(next_pc(program[pc], pc))) {
+      terminates[pc] = true;
+      queue.push_back(static_cast<uint32_t>(pc));
+    }
+  for (size_t head = 0; head < queue.size(); head++)
+    for (auto i = offset[queue[head]]; i < offset[queue[head] + 1]; i++)
+      if (!terminates[preds[i]]) {
+        terminates[preds[i]] = true;
+        queue.push_back(preds[i]);
+      }
+
+  if (n == 0 || terminates[0])
+    return std::nullopt;
+
+  // the original path loops, so the flipped successor's path can't come back to the flip
+  auto visited = std::vector<bool>(n);
+  int64_t pc = 0, r0 = 0;
+  while (inside(pc) && !visited[pc]) {
+    visited[pc] = true;
+    const auto& instr = program[pc];
+    if (instr.ins != ins_e::acc) {
+      auto flipped = instr_t { instr.ins == ins_e::jmp ? ins_e::nop : ins_e::jmp, instr.val };
+      auto next = next_pc(flipped, pc);
+      if (!inside(next) || terminates[next]) {
+        auto fix = repair_t { static_cast<size_t>(pc), instr.ins, flipped.ins, {} };
+        for (; inside(next); next = next_pc(program[next], next))
+          if (program[next].ins == ins_e::acc)
+            r0 += program[next].val;
+        fix.machine = { machine_t::exit_e::normal, static_cast<int>(next), static_cast<int>(r0) };
+        return fix;
+      }
+    }
+    if (instr.ins == ins_e::acc)
+      r0 += instr.val;
+    pc = next_pc(instr, pc);
+  }
+  return std::nullopt;
+}
+
+/**
+ * The brute-force counterpart of `repair`: every `jmp`/`nop` is flipped through a patch and the program is run. The
+ * candidates are handed out in blocks to `n_threads` threads that each reuse one visited buffer. Once a flip exits
+ * normally, threads skip the candidates after it, and the lowest such flip is returned.
+ */
+std::optional<repair_t> search_repair(const program_t& program, size_t n_threads = std::thread::hardware_concurrency()) {
+  static constexpr size_t block = 64;
+  const auto n = program.size();
+  auto next = std::atomic<size_t> {0};
+  auto found = std::atomic<size_t> {n};
+  auto results = std::vector<std::optional<repair_t>>(std::max<size_t>(n_threads, 1));
+
+  auto worker = [&](std::optional<repair_t>& result) {
+    auto visited = std::vector<bool> {};
+    for (auto from = next.fetch_add(block); from < found; from = next.fetch_add(block)) {
+      for (auto pc = from; pc < std::min(from + block, n) && pc < found; pc++) {
+        auto ins = program[pc].ins;
+        if (ins == ins_e::acc)
+          continue;
+        auto flipped = ins == ins_e::jmp ? ins_e::nop : ins_e::jmp;
+        auto m = execute(program, visited, patch_t{pc, flipped});
+        if (m.exit != machine_t::exit_e::normal)
+          continue;
+        if (!result || pc < result->pc)
+          result = repair_t { pc, ins, flipped, m };
+        for (auto f = found.load(); pc < f && !found.compare_exchange_weak(f, pc);) {}
+        break;
+      }
+    }
+  };
+
+  {
+    std::vector<std::jthread> threads;
+    for (size_t t = 1; t < results.size(); t++)
+      threads.emplace_back(worker, std::ref(results[t]));
+    worker(results[0]);
+  }
+
+  std::optional<repair_t> best;
+  for (const auto& r : results)
+    if (r && (!best || r->pc < best->pc))
+      best = r;
+  return best;
+}
+
 }
 
 std::ostream& operator<<(std::ostream& os, const handheld::machine_t::exit_e& e) {
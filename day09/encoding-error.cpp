@@ -1,17 +1,87 @@
 #include <algorithm>
 #include <vector>
 #include <deque>
+#include <optional>
 #include <ranges>
 #include <numeric>
+#include <set>
 #include <span>
 
 #include "day05/arg_input.hpp"
+#include "day05/tokenize.hpp"
+#include "day05/watch.hpp"
 
 namespace ranges = std::ranges;
 
+/**
+ * The numbers with both answers. Numbers can be appended: new numbers are only checked against their own preamble,
+ * and with the failure unchanged only ranges ending at the new numbers are searched.
+ */
+struct xmas_t {
+  size_t preamble_len;
+  std::vector<uint64_t> numbers {};
+  std::optional<size_t> failure {};
+  // contiguous ranges `[first, last]` that add up to the failure
+  std::set<std::pair<size_t, size_t>> ranges {};
+
+  void append(std::span<const uint64_t> more) {
+    auto from = numbers.size();
+    numbers.insert(numbers.end(), more.begin(), more.end());
+
+    if (!failure) {
+      for (auto n = std::max(from, preamble_len); n < numbers.size() && !failure; n++) {
+        bool present = false;
+        for (size_t i = n - preamble_len; i < n; i++)
+          for (size_t j = i+1; j < n; j++)
+            if (numbers[i] + numbers[j] == numbers[n])
+              present = true;
+        if (!present)
+          failure = n;
+      }
+      if (failure)
+        from = 0;
+    }
+    if (!failure)
+      return;
+
+    // the last number never ends a range, so the one before the old end can now
+    auto target = numbers[*failure];
+    for (auto last = from ? from - 1 : 0; last + 1 < numbers.size(); last++) {
+      uint64_t sum = numbers[last];
+      for (auto first = last; first-- > 0;) {
+        sum += numbers[first];
+        if (sum > target)
+          break;
+        if (sum == target)
+          ranges.emplace(first, last);
+      }
+    }
+  }
+
+  void print() const {
+    if (!failure)
+      return;
+    std::cout << "Part 1: first failure " << numbers[*failure] << "\n";
+    for (auto [first, last] : ranges) {
+      auto span = std::span(numbers.cbegin() + first, numbers.cbegin() + last + 1);
+      std::cout << "Part 2: range " << first << "-" << last << ", ";
+      auto [min,max] = ranges::minmax_element(span);
+      std::cout << "min+max: " << *min << "+" << *max << "=" << (*min+*max) << "\n";
+    }
+  }
+};
+
+std::vector<uint64_t> parse(std::span<const std::string> lines) {
+  std::vector<uint64_t> numbers;
+  for (const auto& l : lines)
+    numbers.push_back(std::stoll(l));
+  return numbers;
+}
+
 auto main(int argc, char* argv[]) -> int {
-  if (argc != 3) {
-    std::cout << "Usage: " << argv[0] << " {path-to-file} {preamble length}" << std::endl;
+  auto watch = argc == 4 && std::string_view{argv[3]} == "--watch";
+  if (argc != 3 && !watch) {
+    std::cout << "Usage: " << argv[0] << " {path-to-file} {preamble length} [--watch]" << std::endl;
     return 1;
   }
 
@@ -24,41 +94,20 @@ auto main(int argc, char* argv[]) -> int {
 
   size_t preamble_len = std::stoi(argv[2]);
 
-  std::vector<uint64_t> numbers;
-  for (std::string l; std::getline(input, l); )
-    numbers.push_back(std::stoll(l));
-
-  auto preamble = std::deque<uint64_t> (preamble_len);
-  ranges::copy_n(numbers.cbegin(), preamble_len, preamble.begin());
-
-  auto failure = std::find_if_not(numbers.cbegin() + preamble_len, numbers.cend(), [&preamble](auto number){
-    bool present = false;
-    for (size_t i = 0; i < preamble.size(); i++)
-      for (size_t j = i+1; j < preamble.size(); j++)
-        if (preamble[i] + preamble[j] == number)
-          present = true;
-    preamble.pop_front();
-    preamble.push_back(number);
-    return present;
-  });
-
-  if (failure != numbers.cend()) {
-    std::cout << "Part 1: first failure " << *failure << "\n";
-  } else {
-    return 0;
+  if (watch) {
+    auto xmas = xmas_t { preamble_len };
+    watch_lines(argv[1], [&](const auto& prev, const auto& next) {
+      // anything but an append can move the failure, start over
+      if (prev.empty() || !changed_lines(prev, next).append_only(prev.size()))
+        xmas = xmas_t { preamble_len };
+      auto from = xmas.numbers.size();
+      xmas.append(parse(std::span(next).subspan(from)));
+      std::cout << "Parsed " << next.size() - from << " of " << next.size() << " lines\n";
+      xmas.print();
+    });
   }
 
-  for (size_t i = 0; i < numbers.size(); i++) {
-    for (size_t j = i+2; j < numbers.size(); j++) {
-      auto span = std::span(numbers.cbegin() + i, numbers.cbegin() + j);
-      auto sum = std::accumulate(std::cbegin(span), std::cend(span), 0ull);
-      if (sum > *failure) {
-        break;
-      } else if (sum == *failure) {
-        std::cout << "Part 2: range " << i << "-" << j-1 << ", ";
-        auto [min,max] = ranges::minmax_element(span);
-        std::cout << "min+max: " << *min << "+" << *max << "=" << (*min+*max) << "\n";
-      }
-    }
-  }
-}
\ No newline at end of file
+  auto xmas = xmas_t { preamble_len };
+  xmas.append(parse(tokenize(input)));
+  xmas.print();
+}
@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <numeric>
 #include <ranges>
+#include <unordered_map>
 #include <vector>
 
 namespace ranges = std::ranges;
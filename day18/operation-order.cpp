@@ -1,5 +1,7 @@
 #include "day05/arg_input.hpp"
+#include "day05/profiler.hpp"
 #include "day05/tokenize.hpp"
+#include "day05/watch.hpp"
 
 #include <cstdint>
 #include <variant>
@@ -9,6 +11,7 @@
 #include <ranges>
 #include <iostream>
 #include <numeric>
+#include <optional>
 #include <list>
 
 namespace ranges = std::ranges;
@@ -220,9 +223,51 @@ std::ostream& operator<<(std::ostream& os, const Parse::Node& node) {
   return os;
 }
 
+struct line_result_t {
+  uint64_t p1 = 0, p2 = 0;
+};
+
+line_result_t evaluate(const std::string& line) {
+  auto l = Lex::lex(line);
+  return { Execute::execute(*Parse::parse_p1(l)), Execute::execute(*Parse::parse_p2(l)) };
+}
+
+/**
+ * Keeps the results of the previous version of the lines around. Lines are independent, so after an edit only the
+ * lines between the unchanged prefix and suffix are re-evaluated, wherever they are. An empty `prev` starts over.
+ */
+struct homework_t {
+  std::vector<line_result_t> results;
+  line_result_t sum;
+
+  size_t update(const std::vector<std::string>& prev, const std::vector<std::string>& next) {
+    if (prev.empty()) {
+      results.clear();
+      sum = {};
+    }
+    auto delta = changed_lines(prev, next);
+    auto fresh = std::vector<line_result_t> {};
+    for (auto i = delta.from; i < delta.next_to; i++)
+      fresh.push_back(evaluate(next[i]));
+
+    for (auto i = delta.from; i < delta.prev_to; i++) {
+      sum.p1 -= results[i].p1;
+      sum.p2 -= results[i].p2;
+    }
+    for (const auto& r : fresh) {
+      sum.p1 += r.p1;
+      sum.p2 += r.p2;
+    }
+    results.erase(results.begin() + delta.from, results.begin() + delta.prev_to);
+    results.insert(results.begin() + delta.from, fresh.begin(), fresh.end());
+    return fresh.size();
+  }
+};
+
 auto main(int argc, char* argv[]) -> int {
-  if (argc != 2) {
-    std::cout << "Usage: " << argv[0] << " {path-to-file}" << std::endl;
+  auto watch = argc == 3 && std::string_view{argv[2]} == "--watch";
+  if (argc != 2 && !watch) {
+    std::cout << "Usage: " << argv[0] << " {path-to-file} [--watch]" << std::endl;
     return 1;
   }
 
@@ -233,6 +278,16 @@ auto main(int argc, char* argv[]) -> int {
 
   auto& input = std::get<std::ifstream>(file);
 
+  if (watch) {
+    auto homework = homework_t {};
+    watch_lines(argv[1], [&](const auto& prev, const auto& next) {
+      auto evaluated = homework.update(prev, next);
+      std::cout << "Re-evaluated " << evaluated << " of " << next.size() << " lines\n";
+      std::cout << "Part 1: " << homework.sum.p1 << "\n";
+      std::cout << "Part 2: " << homework.sum.p2 << "\n";
+    });
+  }
+
   auto tokens = tokenize(input);
 
   auto l = Lex::lex("2 * 3 + 4");
@@ -240,15 +295,20 @@ auto main(int argc, char* argv[]) -> int {
   std::cout << *p << std::endl;
   std::cout << Execute::execute(*p) << "\n";
 
-  auto sum = std::accumulate(tokens.cbegin(), tokens.cend(), uint64_t {0}, [](auto a, const auto& line) {
-    auto l = Lex::lex(line);
-    auto p = Parse::parse_p1(l);
-    auto r = Execute::execute(*p);
-    return a + r;
-  });
+  auto sum = uint64_t {0};
+  {
+    auto phase = profiler::phase {"part1"};
+    sum = std::accumulate(tokens.cbegin(), tokens.cend(), uint64_t {0}, [](auto a, const auto& line) {
+      auto l = Lex::lex(line);
+      auto p = Parse::parse_p1(l);
+      auto r = Execute::execute(*p);
+      return a + r;
+    });
+  }
 
   std::cout << "Part 1: " << sum << "\n";
 
+  auto phase = profiler::phase {"part2"};
   sum = std::accumulate(tokens.cbegin(), tokens.cend(), uint64_t {0}, [](auto a, const auto& line) {
     auto l = Lex::lex(line);
     auto p = Parse::parse_p2(l);
@@ -259,4 +319,4 @@ auto main(int argc, char* argv[]) -> int {
   std::cout << "Part 2: " << sum << "\n";
 
   return 0;
-}
\ No newline at end of file
+}
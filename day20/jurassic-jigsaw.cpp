@@ -1,12 +1,16 @@
 #include "day05/arg_input.hpp"
 #include "day05/tokenize.hpp"
+#include "day05/dispatch.hpp"
 
 #include <array>
 #include <algorithm>
 #include <ranges>
 #include <numeric>
 #include <set>
+#include <unordered_map>
 #include <cmath>
+#include <span>
+#include <type_traits>
 
 namespace ranges = std::ranges;
 
@@ -15,28 +19,43 @@ namespace ranges = std::ranges;
  * Especially the matrix transformations, resizing and sea-monster matching took quite a few lines of code.
  */
 
+enum class rotation_e { Rot0 = 0, Rot90, Rot180, Rot270, FlipRot0, FlipRot90, FlipRot180, FlipRot270 };
+enum class edge_e { Top = 0, Right, Bottom, Left, TopFlip, RightFlip, BottomFlip, LeftFlip };
+
+/**
+ * Tiles of `Size` x `Size`, `std::dynamic_extent` stores lines in vectors so that any size can be handled.
+ */
 template<size_t Size=10>
 struct generic_tile_t {
   static constexpr size_t N = Size;
+  static constexpr bool is_dynamic = N == std::dynamic_extent;
   size_t id = 0;
-  enum class rotation_e { Rot0 = 0, Rot90, Rot180, Rot270, FlipRot0, FlipRot90, FlipRot180, FlipRot270 };
-  using line_t = std::array<char, N>;
-  enum class edge_e { Top = 0, Right, Bottom, Left, TopFlip, RightFlip, BottomFlip, LeftFlip };
+  using rotation_e = ::rotation_e;
+  using line_t = std::conditional_t<is_dynamic, std::vector<char>, std::array<char, N>>;
+  using edge_e = ::edge_e;
   using edges_t = std::array<line_t, 8>;
   using corner_t = std::pair<line_t, line_t>;
   using corners_t = std::array<corner_t, 8>;
-  using data_t = std::array<line_t, N>;
+  using data_t = std::conditional_t<is_dynamic, std::vector<line_t>, std::array<line_t, N>>;
   data_t data = {};
 
+  generic_tile_t() = default;
+  explicit generic_tile_t(size_t size) {
+    if constexpr (is_dynamic)
+      data.assign(size, line_t(size));
+  }
+
+  [[nodiscard]] size_t size() const { return data.size(); }
+
   [[nodiscard]] edges_t make_edges() const {
     auto edgs = edges_t {};
-    auto right = line_t {};
+    auto right = data.front();
     ranges::transform(data, right.begin(), [](const auto& l){
       return l.back();
     });
     auto bottom = data.back();
     ranges::reverse(bottom);
-    auto left = line_t {};
+    auto left = data.front();
     ranges::transform(data, left.begin(), [](const auto& l){
       return l.front();
     });
@@ -55,7 +74,7 @@ struct generic_tile_t {
   edges_t edges {};
 
   [[nodiscard]] corners_t make_corners() const {
-    auto eds = edges.empty() ? make_edges() : edges;
+    auto eds = edges.front().empty() ? make_edges() : edges;
     auto crns = corners_t {};
 
     for (size_t i = 0; i < 4; i++)
@@ -81,28 +100,32 @@ struct generic_tile_t {
     }
   };
 };
-using tile_t = generic_tile_t<10>;
-using tiles_t = std::unordered_map<size_t, tile_t>;
+template<size_t N>
+using tiles_t = std::unordered_map<size_t, generic_tile_t<N>>;
 
-tiles_t read_tiles(const std::vector<std::string>& tokens) {
-  auto tiles = tiles_t {};
+template<size_t N>
+tiles_t<N> read_tiles(const std::vector<std::string>& tokens, size_t size) {
+  using tile_t = generic_tile_t<N>;
+  auto tiles = tiles_t<N> {};
 
   auto it = tokens.cbegin();
-  auto tile = tile_t {};
+  auto tile = tile_t {size};
   static constexpr auto id_prefix = std::string_view {"Tile "};
-  auto row = 0;
+  size_t row = 0;
   while (it != tokens.cend()) {
     if (it->empty()) { // make sure to end with an empty line
-      if (row == 10) {
+      if (row == size) {
         tile.edges = tile.make_edges();
         tile.corners = tile.make_corners();
         tiles[tile.id] = tile;
       }
       row = 0;
-      tile = {};
+      tile = tile_t {size};
     } else if (it->starts_with(id_prefix)) {
       tile.id = std::stoull(it->substr(id_prefix.size(), it->size() - id_prefix.size()-1));
     } else {
+      if (row >= size || it->size() != size)
+        throw std::invalid_argument("Tiles should be square and of equal size");
       ranges::copy(*it, tile.data[row++].begin());
     }
 
@@ -118,21 +141,26 @@ tiles_t read_tiles(const std::vector<std::string>& tokens) {
 struct tile_orientation_t {
   size_t id;
   // the rotation to apply to get this to top-right / top
-  tile_t::rotation_e orientation;
+  rotation_e orientation;
 };
 
-using edge_tile_catalog_t = std::unordered_multimap<tile_t::line_t, tile_orientation_t, tile_t::line_hash>;
-using corner_tile_catalog_t = std::unordered_multimap<tile_t::corner_t, tile_orientation_t, tile_t::corner_hash>;
+template<size_t N>
+using edge_tile_catalog_t = std::unordered_multimap<typename generic_tile_t<N>::line_t, tile_orientation_t,
+                                                    typename generic_tile_t<N>::line_hash>;
+template<size_t N>
+using corner_tile_catalog_t = std::unordered_multimap<typename generic_tile_t<N>::corner_t, tile_orientation_t,
+                                                      typename generic_tile_t<N>::corner_hash>;
 
-auto make_catalogs(const tiles_t& tiles) {
-  auto edges = edge_tile_catalog_t {};
-  auto corners = corner_tile_catalog_t {};
+template<size_t N>
+auto make_catalogs(const tiles_t<N>& tiles) {
+  auto edges = edge_tile_catalog_t<N> {};
+  auto corners = corner_tile_catalog_t<N> {};
 
   ranges::for_each(tiles, [&](const auto& tile){
     auto es = tile.second.edges;
     auto cs = tile.second.corners;
     for (size_t e = 0; e < es.size(); e++) {
-      auto r = static_cast<tile_t::rotation_e>(e);
+      auto r = static_cast<rotation_e>(e);
       edges.insert({es.at(e), {tile.first, r}});
       corners.insert({cs.at(e), {tile.first, r}});
     }
@@ -141,11 +169,12 @@ auto make_catalogs(const tiles_t& tiles) {
   return std::make_tuple(edges, corners);
 }
 
-using image_t = std::vector<std::vector<std::pair<size_t, tile_t::rotation_e>>>;
+using image_t = std::vector<std::vector<std::pair<size_t, rotation_e>>>;
 
 struct state_t {
   using tile_ids_t = std::set<size_t>;
-  state_t(size_t width, size_t height, const tiles_t& tiles)
+  template<typename Tiles>
+  state_t(size_t width, size_t height, const Tiles& tiles)
       : w{width}, h{height}, image(height, image_t::value_type(width))
   {
     for (const auto& t : tiles) {
@@ -172,20 +201,22 @@ struct state_t {
   const size_t w = 0, h = 0;
 };
 
-constexpr auto next_edge(tile_t::rotation_e r, size_t step) {
+constexpr auto next_edge(rotation_e r, size_t step) {
   auto i = static_cast<int>(r);
   return 4 * ( i/4 ) + ( (i+step)%4 );
 };
-static_assert(next_edge(tile_t::rotation_e::FlipRot270, 3)==6);
-static_assert(next_edge(tile_t::rotation_e::Rot0, 0)==0);
-static_assert(next_edge(tile_t::rotation_e::Rot270, 1)==0);
-
-template<typename CT, typename T>
-auto solve_next(const tiles_t&, const edge_tile_catalog_t&,
-                const corner_tile_catalog_t&, state_t,
-                const CT&, const T&, tile_t::edge_e) -> std::vector<state_t>;
-
-auto solve(const tiles_t& tiles, const edge_tile_catalog_t& edges, const corner_tile_catalog_t& corners, state_t state) -> std::vector<state_t> {
+static_assert(next_edge(rotation_e::FlipRot270, 3)==6);
+static_assert(next_edge(rotation_e::Rot0, 0)==0);
+static_assert(next_edge(rotation_e::Rot270, 1)==0);
+
+template<size_t N, typename CT, typename T>
+auto solve_next(const tiles_t<N>&, const edge_tile_catalog_t<N>&,
+                const corner_tile_catalog_t<N>&, state_t,
+                const CT&, const T&, edge_e) -> std::vector<state_t>;
+
+template<size_t N>
+auto solve(const tiles_t<N>& tiles, const edge_tile_catalog_t<N>& edges, const corner_tile_catalog_t<N>& corners, state_t state) -> std::vector<state_t> {
+  using tile_t = generic_tile_t<N>;
   if (state.available.empty())
     return {state};
 
@@ -196,7 +227,7 @@ auto solve(const tiles_t& tiles, const edge_tile_catalog_t& edges, const corner_
       substate.next_pos();
       substate.available.erase(tile_id);
       for (size_t rot = 0; rot < 8; rot++) {
-        substate.image[state.row][state.col] = {tile_id, static_cast<tile_t::rotation_e>(rot)};
+        substate.image[state.row][state.col] = {tile_id, static_cast<rotation_e>(rot)};
         auto subres = solve(tiles, edges, corners, substate);
         ranges::copy(subres, std::back_inserter(res));
       }
@@ -211,7 +242,7 @@ auto solve(const tiles_t& tiles, const edge_tile_catalog_t& edges, const corner_
     auto adjecent_edge = tile_adjacent.edges[i_edge];
     ranges::reverse(adjecent_edge); // reverse edge to find target edge
     return solve_next(tiles, edges, corners, state, edges,
-                      adjecent_edge, is_top ? tile_t::edge_e::Left : tile_t::edge_e::Top);
+                      adjecent_edge, is_top ? edge_e::Left : edge_e::Top);
   } else {
     // cornered tiles
     const auto &image_top = state.image[state.row - 1][state.col];
@@ -221,17 +252,17 @@ auto solve(const tiles_t& tiles, const edge_tile_catalog_t& edges, const corner_
 
     size_t i_right_edge = next_edge(image_left.second, 1);
     size_t i_bottom_edge = next_edge(image_top.second, 2);
-    auto left_top_corner = tile_t::corner_t{tile_left.edges[i_right_edge], tile_top.edges[i_bottom_edge]};
+    auto left_top_corner = typename tile_t::corner_t{tile_left.edges[i_right_edge], tile_top.edges[i_bottom_edge]};
     ranges::reverse(left_top_corner.first);
     ranges::reverse(left_top_corner.second);
-    return solve_next(tiles, edges, corners, state, corners, left_top_corner, tile_t::edge_e::Left);
+    return solve_next(tiles, edges, corners, state, corners, left_top_corner, edge_e::Left);
   };
 };
 
-template<typename CT, typename T>
-auto solve_next(const tiles_t& tiles, const edge_tile_catalog_t& edges,
-                const corner_tile_catalog_t& corners, state_t state,
-                const CT& options, const T& match, tile_t::edge_e target_edge) -> std::vector<state_t> {
+template<size_t N, typename CT, typename T>
+auto solve_next(const tiles_t<N>& tiles, const edge_tile_catalog_t<N>& edges,
+                const corner_tile_catalog_t<N>& corners, state_t state,
+                const CT& options, const T& match, edge_e target_edge) -> std::vector<state_t> {
   std::vector<state_t> res;
   auto[candidate_begin, candidate_end] = options.equal_range(match);
   if (candidate_begin == candidate_end)
@@ -243,8 +274,8 @@ auto solve_next(const tiles_t& tiles, const edge_tile_catalog_t& edges,
     auto substate = state;
     substate.next_pos();
     // try to achieve the target rotation
-    auto next_rotation = static_cast<tile_t::rotation_e>(next.second.orientation);
-    auto rot = static_cast<tile_t::rotation_e>(next_edge(next_rotation, target_edge==tile_t::edge_e::Left ? 1 : 0));
+    auto next_rotation = static_cast<rotation_e>(next.second.orientation);
+    auto rot = static_cast<rotation_e>(next_edge(next_rotation, target_edge==edge_e::Left ? 1 : 0));
     substate.image[state.row][state.col] = {next.second.id, rot};
     substate.available.erase(next.second.id);
     auto results = solve(tiles, edges, corners, substate);
@@ -253,8 +284,9 @@ auto solve_next(const tiles_t& tiles, const edge_tile_catalog_t& edges,
   return res;
 }
 
-std::vector<std::vector<char>> cutout(const tile_t& tile, tile_t::rotation_e rotation) {
-  auto len = tile_t::N-2;
+template<size_t N>
+std::vector<std::vector<char>> cutout(const generic_tile_t<N>& tile, rotation_e rotation) {
+  auto len = tile.size()-2;
   std::vector<std::vector<char>> cutout (len, std::vector<char>(len, 'x'));
 
   size_t i = 0;
@@ -308,9 +340,10 @@ auto sea_monster() {
   return std::make_tuple(sea_monster_coords, sea_monster_hashtags, x, y);
 }
 
-std::optional<size_t> sea_roughness(const tiles_t& tiles, const state_t& state) {
-  static constexpr auto tile_width = tile_t::N - 2;
-  static auto image_size = std::make_pair(tile_width*state.w, tile_width*state.h);
+template<size_t N>
+std::optional<size_t> sea_roughness(const tiles_t<N>& tiles, const state_t& state) {
+  const auto tile_width = tiles.cbegin()->second.size() - 2;
+  const auto image_size = std::make_pair(tile_width*state.w, tile_width*state.h);
 
   using composed_image_t = std::vector<std::vector<char>>;
   auto image = composed_image_t (image_size.second, composed_image_t::value_type (image_size.first, 'x'));
@@ -353,22 +386,9 @@ std::optional<size_t> sea_roughness(const tiles_t& tiles, const state_t& state)
   return image_hashtags - sea_monster_locations.size() * sea_monster_hashtags;
 }
 
-auto main(int argc, char* argv[]) -> int {
-  if (argc != 2) {
-    std::cout << "Usage: " << argv[0] << " {path-to-file}" << std::endl;
-    return 1;
-  }
-
-  auto file = get_input(argc, argv);
-
-  if (std::holds_alternative<int>(file))
-    return std::get<int>(file);
-
-  auto& input = std::get<std::ifstream>(file);
-
-  auto tokens = tokenize(input);
-
-  auto tiles = read_tiles(tokens);
+template<size_t N>
+auto assemble(const std::vector<std::string>& tokens, size_t size) {
+  auto tiles = read_tiles<N>(tokens, size);
 
   // make LUTs
   auto [edges, corners] = make_catalogs(tiles);
@@ -381,7 +401,7 @@ auto main(int argc, char* argv[]) -> int {
   auto a1 = res.front().magic_number();
   std::cout << "Part 1: " << a1 << "\n";
 
-  size_t a2;
+  size_t a2 = 0;
   for (const auto& r : res) {
     auto rough = sea_roughness(tiles, r);
     if (rough) {
@@ -391,5 +411,29 @@ auto main(int argc, char* argv[]) -> int {
     }
   }
 
+  return std::make_pair(a1, a2);
+}
+
+auto main(int argc, char* argv[]) -> int {
+  if (argc != 2) {
+    std::cout << "Usage: " << argv[0] << " {path-to-file}" << std::endl;
+    return 1;
+  }
+
+  auto file = get_input(argc, argv);
+
+  if (std::holds_alternative<int>(file))
+    return std::get<int>(file);
+
+  auto& input = std::get<std::ifstream>(file);
+
+  auto tokens = tokenize(input);
+
+  // the puzzle uses 10x10 tiles, other sizes take the generic path
+  auto size = tokens.size() > 1 ? tokens[1].size() : 0;
+  auto [a1, a2] = dispatch_size<8, 10, 12, 16>(size, [&](auto n) {
+    return assemble<decltype(n)::value>(tokens, size);
+  });
+
   std::cout << a1 << "\n" << a2 << "\n";
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <numeric>
 #include <ranges>
 #include <set>
+#include <unordered_map>
 #include <sstream>
 
 namespace ranges = std::ranges;
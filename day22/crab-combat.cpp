@@ -6,6 +6,7 @@
 #include <list>
 #include <numeric>
 #include <set>
+#include <unordered_map>
 #include <unordered_set>
 #include <deque>
 
@@ -2,6 +2,7 @@
 #include <iostream>
 #include <list>
 #include <ranges>
+#include <unordered_map>
 
 namespace ranges = std::ranges;
 
@@ -0,0 +1,348 @@
+#include "day05/tokenize.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * Hill-climbs mutations of a valid puzzle input to find inputs that maximize the runtime or peak memory of a solver.
+ * The solver is run as a child process so that crashes and resource limits don't take the search down with it.
+ * Every new worst case is written to the output directory and listed in `benchmarks.tsv` for later regression runs.
+ */
+
+namespace ranges = std::ranges;
+namespace fs = std::filesystem;
+
+using lines_t = std::vector<std::string>;
+
+enum class metric_e { time, memory };
+
+struct options_t {
+  fs::path solver, seed, out;
+  size_t iterations = 1000;
+  size_t size_cap = 0; // 0: twice the seed size
+  metric_e metric = metric_e::time;
+  rlim_t timeout = 10; // CPU seconds per run
+  uint64_t rng_seed = 2020;
+  std::vector<std::string> solver_args {};
+};
+
+struct run_t {
+  enum class exit_e { normal, failure, timeout };
+  exit_e exit = exit_e::failure;
+  double cpu_ms = 0;
+  long max_rss_kb = 0;
+};
+
+auto score(const run_t& run, metric_e metric) -> double {
+  return metric == metric_e::time ? run.cpu_ms : static_cast<double>(run.max_rss_kb);
+}
+
+auto run_solver(const options_t& opts, const fs::path& input) -> run_t {
+  auto pid = fork();
+  if (pid < 0)
+    throw std::runtime_error(std::string("fork: ") + std::strerror(errno));
+
+  if (pid == 0) {
+    auto devnull = open("/dev/null", O_WRONLY);
+    dup2(devnull, STDOUT_FILENO);
+    dup2(devnull, STDERR_FILENO);
+
+    auto limit = rlimit { opts.timeout, opts.timeout + 1 };
+    setrlimit(RLIMIT_CPU, &limit);
+
+    auto args = std::vector<std::string> { opts.solver.string(), input.string() };
+    ranges::copy(opts.solver_args, std::back_inserter(args));
+    auto argv = std::vector<char*> {};
+    for (auto& a : args)
+      argv.push_back(a.data());
+    argv.push_back(nullptr);
+
+    execv(argv.front(), argv.data());
+    _exit(127);
+  }
+
+  int status = 0;
+  auto usage = rusage {};
+  if (wait4(pid, &status, 0, &usage) < 0)
+    throw std::runtime_error(std::string("wait4: ") + std::strerror(errno));
+
+  auto run = run_t {};
+  auto ms = [](const timeval& tv) { return tv.tv_sec * 1e3 + tv.tv_usec / 1e3; };
+  run.cpu_ms = ms(usage.ru_utime) + ms(usage.ru_stime);
+  run.max_rss_kb = usage.ru_maxrss;
+
+  if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+    run.exit = run_t::exit_e::normal;
+  else if (WIFSIGNALED(status) && (WTERMSIG(status) == SIGXCPU || WTERMSIG(status) == SIGKILL))
+    run.exit = run_t::exit_e::timeout;
+
+  return run;
+}
+
+// run a couple of times and keep the fastest to suppress scheduling noise
+auto measure(const options_t& opts, const fs::path& input) -> run_t {
+  auto best = run_solver(opts, input);
+  if (opts.metric != metric_e::time || best.exit != run_t::exit_e::normal)
+    return best;
+  for (size_t i = 0; i < 2; i++) {
+    auto r = run_solver(opts, input);
+    if (r.exit != run_t::exit_e::normal)
+      return r;
+    best.cpu_ms = std::min(best.cpu_ms, r.cpu_ms);
+  }
+  return best;
+}
+
+auto size_of(const lines_t& lines) {
+  size_t s = 0;
+  for (const auto& l : lines)
+    s += l.size() + 1;
+  return s;
+}
+
+void write_lines(const fs::path& path, const lines_t& lines) {
+  auto out = std::ofstream { path };
+  for (const auto& l : lines)
+    out << l << "\n";
+  if (!out.good())
+    throw std::runtime_error("Couldn't write " + path.string());
+}
+
+/**
+ * Mutations try to keep the input well-formed: separators and structure are preserved and characters are only
+ * replaced by characters of the same class that already occur on the line (digits by digits, `#` by `.`, etc.).
+ */
+struct mutator_t {
+  std::mt19937_64 rng;
+
+  auto pick(size_t n) { return std::uniform_int_distribution<size_t>{0, n - 1}(rng); }
+
+  static bool mutable_char(char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '#' || c == '.'; }
+
+  bool mutate_char(lines_t& lines) {
+    auto& l = lines[pick(lines.size())];
+    if (l.empty())
+      return false;
+    auto pos = pick(l.size());
+    auto c = l[pos];
+    if (!mutable_char(c))
+      return false;
+    if (std::isdigit(static_cast<unsigned char>(c))) {
+      l[pos] = static_cast<char>('0' + pick(10));
+    } else {
+      auto alphabet = std::string {};
+      ranges::copy_if(l, std::back_inserter(alphabet), [](char ch) {
+        return mutable_char(ch) && !std::isdigit(static_cast<unsigned char>(ch));
+      });
+      l[pos] = alphabet[pick(alphabet.size())];
+    }
+    return l[pos] != c;
+  }
+
+  bool duplicate_line(lines_t& lines) {
+    auto from = pick(lines.size());
+    if (lines[from].empty())
+      return false;
+    auto copy = lines[from];
+    lines.insert(lines.begin() + pick(lines.size() + 1), copy);
+    return true;
+  }
+
+  bool delete_line(lines_t& lines) {
+    if (lines.size() < 2)
+      return false;
+    auto at = pick(lines.size());
+    if (lines[at].empty())
+      return false;
+    lines.erase(lines.begin() + at);
+    return true;
+  }
+
+  bool swap_lines(lines_t& lines) {
+    auto a = pick(lines.size()), b = pick(lines.size());
+    if (lines[a] == lines[b] || lines[a].empty() != lines[b].empty())
+      return false;
+    std::swap(lines[a], lines[b]);
+    return true;
+  }
+
+  // blank-line-delimited records (passports, tiles, decks, ...) are duplicated as a whole
+  bool duplicate_record(lines_t& lines) {
+    auto blanks = std::vector<size_t> {};
+    for (size_t i = 0; i < lines.size(); i++)
+      if (lines[i].empty())
+        blanks.push_back(i);
+    if (blanks.size() < 2)
+      return false;
+    auto i = pick(blanks.size() - 1);
+    auto from = blanks[i] + 1, to = blanks[i + 1] + 1;
+    auto record = lines_t (lines.cbegin() + from, lines.cbegin() + to);
+    lines.insert(lines.begin() + blanks[pick(blanks.size())] + 1, record.cbegin(), record.cend());
+    return true;
+  }
+
+  // a few random mutations of `lines`, nullopt if none applies within `max_attempts` tries (e.g. only blank lines)
+  auto operator()(lines_t lines) -> std::optional<lines_t> {
+    static constexpr size_t max_attempts = 10000;
+    auto n = 1 + pick(3);
+    for (size_t i = 0, attempts = 0; i < n; attempts++) {
+      if (attempts == max_attempts)
+        return std::nullopt;
+      bool changed = false;
+      switch (pick(5)) {
+        case 0: changed = mutate_char(lines); break;
+        case 1: changed = duplicate_line(lines); break;
+        case 2: changed = delete_line(lines); break;
+        case 3: changed = swap_lines(lines); break;
+        case 4: changed = duplicate_record(lines); break;
+      }
+      if (changed)
+        i++;
+    }
+    return lines;
+  }
+};
+
+auto parse_options(int argc, char* argv[]) -> std::optional<options_t> {
+  if (argc < 4)
+    return std::nullopt;
+
+  auto opts = options_t { argv[1], argv[2], argv[3] };
+  for (int i = 4; i < argc; i++) {
+    auto arg = std::string_view { argv[i] };
+    if (arg == "--") {
+      for (i++; i < argc; i++)
+        opts.solver_args.emplace_back(argv[i]);
+      break;
+    }
+    if (i + 1 >= argc)
+      return std::nullopt;
+    auto val = std::string { argv[++i] };
+    if (arg == "--iterations")
+      opts.iterations = std::stoull(val);
+    else if (arg == "--cap")
+      opts.size_cap = std::stoull(val);
+    else if (arg == "--timeout")
+      opts.timeout = std::stoull(val);
+    else if (arg == "--seed")
+      opts.rng_seed = std::stoull(val);
+    else if (arg == "--metric" && (val == "time" || val == "memory"))
+      opts.metric = val == "time" ? metric_e::time : metric_e::memory;
+    else
+      return std::nullopt;
+  }
+  return opts;
+}
+
+auto main(int argc, char* argv[]) -> int {
+  auto parsed = parse_options(argc, argv);
+  if (!parsed) {
+    std::cout << "Usage: " << argv[0] << " {solver} {valid-input} {out-dir}"
+              << " [--iterations N] [--cap bytes] [--metric time|memory] [--timeout cpu-seconds] [--seed N]"
+              << " [-- solver-args...]" << std::endl;
+    return 1;
+  }
+  auto& opts = *parsed;
+
+  auto file = std::ifstream { opts.seed };
+  if (!file.good()) {
+    std::cerr << "Couldn't read " << opts.seed << std::endl;
+    return 1;
+  }
+  auto current = tokenize(file);
+  if (current.empty()) {
+    std::cerr << "Empty input " << opts.seed << std::endl;
+    return 1;
+  }
+  if (opts.size_cap == 0)
+    opts.size_cap = 2 * size_of(current);
+
+  fs::create_directories(opts.out);
+  auto scratch = opts.out / "candidate.input";
+
+  write_lines(scratch, current);
+  auto baseline = measure(opts, scratch);
+  if (baseline.exit != run_t::exit_e::normal) {
+    std::cerr << "Solver doesn't accept the seed input" << std::endl;
+    return 1;
+  }
+
+  // numbering continues after the cases of earlier runs into the same directory, which the index still points at
+  size_t n = 0;
+  {
+    auto existing = std::ifstream { opts.out / "benchmarks.tsv" };
+    for (std::string line; std::getline(existing, line);)
+      n += !line.empty();
+  }
+  auto index = std::ofstream { opts.out / "benchmarks.tsv", std::ios::app };
+  auto save = [&](const lines_t& lines, const run_t& run, std::string_view kind) {
+    std::ostringstream name;
+    do {
+      name.str({});
+      name << kind << "-" << std::setw(3) << std::setfill('0') << n++ << ".input";
+    } while (fs::exists(opts.out / name.str()));
+    write_lines(opts.out / name.str(), lines);
+    index << name.str() << "\t" << run.cpu_ms << "\t" << run.max_rss_kb << "\t" << size_of(lines) << std::endl;
+    std::cout << "Saved " << name.str() << ": " << run.cpu_ms << " ms, " << run.max_rss_kb << " kB, "
+              << size_of(lines) << " bytes" << std::endl;
+  };
+
+  auto mutate = mutator_t { std::mt19937_64 { opts.rng_seed } };
+  auto current_score = score(baseline, opts.metric), best_score = current_score;
+  std::cout << "Seed: " << baseline.cpu_ms << " ms, " << baseline.max_rss_kb << " kB" << std::endl;
+
+  for (size_t it = 0; it < opts.iterations; it++) {
+    auto mutated = mutate(current);
+    if (!mutated) {
+      std::cerr << "No mutation applies to the input" << std::endl;
+      return 1;
+    }
+    auto candidate = std::move(*mutated);
+    if (size_of(candidate) > opts.size_cap)
+      continue;
+
+    write_lines(scratch, candidate);
+    auto run = measure(opts, scratch);
+
+    if (run.exit == run_t::exit_e::timeout) {
+      // a pathology by definition; keep it but don't climb on from an input we can't measure
+      save(candidate, run, "timeout");
+      continue;
+    }
+    if (run.exit != run_t::exit_e::normal)
+      continue; // rejected by the solver, not a valid input
+
+    auto s = score(run, opts.metric);
+    if (s < current_score)
+      continue;
+
+    // accept plateau moves too, they let the search drift towards larger inputs
+    current = std::move(candidate);
+    current_score = s;
+    if (s > best_score * 1.05) {
+      best_score = s;
+      save(current, run, "worst");
+    }
+  }
+
+  fs::remove(scratch);
+  std::cout << "Worst " << (opts.metric == metric_e::time ? "CPU time: " : "peak RSS: ") << best_score
+            << (opts.metric == metric_e::time ? " ms" : " kB") << std::endl;
+}